@@ -46,6 +46,7 @@ namespace webserver {
 	{
 		METHOD_HANDLER(Access::ADMIN, METHOD_POST, (EXACT_PARAM("start")), ExtensionInfo::handleStartExtension);
 		METHOD_HANDLER(Access::ADMIN, METHOD_POST, (EXACT_PARAM("stop")), ExtensionInfo::handleStopExtension);
+		METHOD_HANDLER(Access::ANY, METHOD_POST, (EXACT_PARAM("ready")), ExtensionInfo::handlePostReady);
 
 		METHOD_HANDLER(Access::SETTINGS_VIEW, METHOD_GET, (EXACT_PARAM("settings"), EXACT_PARAM("definitions")), ExtensionInfo::handleGetSettingDefinitions);
 		METHOD_HANDLER(Access::SETTINGS_EDIT, METHOD_POST, (EXACT_PARAM("settings"), EXACT_PARAM("definitions")), ExtensionInfo::handlePostSettingDefinitions);
@@ -83,6 +84,22 @@ namespace webserver {
 		return websocketpp::http::status_code::no_content;
 	}
 
+	api_return ExtensionInfo::handlePostReady(ApiRequest& aRequest) {
+		if (extension->getSession() != aRequest.getSession()) {
+			aRequest.setResponseErrorStr("Ready state may only be set by the owning session");
+			return websocketpp::http::status_code::conflict;
+		}
+
+		try {
+			extension->setReady();
+		} catch (const Exception& e) {
+			aRequest.setResponseErrorStr(e.what());
+			return websocketpp::http::status_code::conflict;
+		}
+
+		return websocketpp::http::status_code::no_content;
+	}
+
 	api_return ExtensionInfo::handleGetSettings(ApiRequest& aRequest) {
 		aRequest.setResponseBody(extension->getSettingValues());
 		return websocketpp::http::status_code::ok;
@@ -136,6 +153,7 @@ namespace webserver {
 			{ "homepage", aExtension->getHomepage() },
 			{ "author", aExtension->getAuthor() },
 			{ "running", aExtension->isRunning() },
+			{ "ready_state", Extension::readyStateToString(aExtension->getReadyState()) },
 			{ "private", aExtension->isPrivate() },
 			{ "logs", ExtensionInfo::serializeLogs(aExtension) },
 			{ "engines", aExtension->getEngines() },
@@ -196,6 +214,14 @@ namespace webserver {
 		});
 	}
 
+	void ExtensionInfo::on(ExtensionListener::ReadyStateChanged) noexcept {
+		onUpdated([&] {
+			return json({
+				{ "ready_state", Extension::readyStateToString(extension->getReadyState()) }
+			});
+		});
+	}
+
 	void ExtensionInfo::onUpdated(const JsonCallback& aDataCallback) noexcept {
 		maybeSend("extension_updated", aDataCallback);
 	}
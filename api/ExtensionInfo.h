@@ -57,9 +57,11 @@ namespace webserver {
 		void on(ExtensionListener::ExtensionStarted) noexcept override;
 		void on(ExtensionListener::ExtensionStopped, bool aFailed) noexcept override;
 		void on(ExtensionListener::PackageUpdated) noexcept override;
+		void on(ExtensionListener::ReadyStateChanged) noexcept override;
 
 		api_return handleStartExtension(ApiRequest& aRequest);
 		api_return handleStopExtension(ApiRequest& aRequest);
+		api_return handlePostReady(ApiRequest& aRequest);
 
 		api_return handleGetSettingDefinitions(ApiRequest& aRequest);
 		api_return handlePostSettingDefinitions(ApiRequest& aRequest);
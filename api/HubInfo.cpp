@@ -64,12 +64,16 @@ namespace webserver {
 	HubInfo::~HubInfo() {
 		timer->stop(true);
 
+		leaveEventGroup();
 		client->removeListener(this);
 	}
 
 	void HubInfo::init() noexcept {
 		client->addListener(this);
 
+		// User events are identical for all sessions
+		joinEventGroup("hub_" + Util::toString(getId()));
+
 		timer->start(false);
 	}
 
@@ -332,7 +336,7 @@ namespace webserver {
 			view.onItemAdded(aUser);
 		}
 
-		maybeSend("hub_user_connected", [&] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
+		publishAsync(userConnectedSubscription, [aUser] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
 	}
 
 	void HubInfo::onUserUpdated(const OnlineUserPtr& ou) noexcept {
@@ -351,7 +355,7 @@ namespace webserver {
 			view.onItemUpdated(aUser, aUpdatedProperties);
 		}
 
-		maybeSend("hub_user_updated", [&] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
+		publishAsync(userUpdatedSubscription, [aUser] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
 	}
 
 	void HubInfo::on(ClientListener::UserUpdated, const Client*, const OnlineUserPtr& aUser) noexcept {
@@ -369,6 +373,6 @@ namespace webserver {
 			view.onItemRemoved(aUser);
 		}
 
-		maybeSend("hub_user_disconnected", [&] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
+		publishAsync(userDisconnectedSubscription, [aUser] { return Serializer::serializeItem(aUser, OnlineUserUtils::propertyHandler); });
 	}
 }
\ No newline at end of file
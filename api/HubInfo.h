@@ -56,6 +56,11 @@ namespace webserver {
 		void init() noexcept override;
 		ClientToken getId() const noexcept override;
 	private:
+		// User events are fired frequently, resolve the subscriptions only once
+		const SubscriptionId userConnectedSubscription = getSubscriptionId("hub_user_connected");
+		const SubscriptionId userUpdatedSubscription = getSubscriptionId("hub_user_updated");
+		const SubscriptionId userDisconnectedSubscription = getSubscriptionId("hub_user_disconnected");
+
 		api_return handleUpdateHub(ApiRequest& aRequest);
 
 		api_return handleReconnect(ApiRequest& aRequest);
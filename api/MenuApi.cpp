@@ -38,6 +38,10 @@
 #include <airdcpp/PrivateChatManager.h>
 #include <airdcpp/SearchManager.h>
 #include <airdcpp/SearchInstance.h>
+#include <airdcpp/TimerManager.h>
+
+#define MENU_LIST_HOOK_TIMEOUT_SECONDS 1
+#define MENU_LIST_HOOK_TIMEOUT_MS (MENU_LIST_HOOK_TIMEOUT_SECONDS * 1000)
 
 
 #define CONTEXT_MENU_HANDLER(menuId, hook, hook2, idType, idDeserializerFunc, idSerializerFunc, access) \
@@ -275,6 +279,43 @@ namespace webserver {
 		return ExtensionSettingItem::List();
 	}
 
+	MenuApi::HookCompletionDataPtr MenuApi::fireMenuListHook(const string& aMenuId, JsonCallback&& aJsonCallback) noexcept {
+		const auto hookId = toHookId(aMenuId);
+
+		auto request = ContextMenuListRequest::getCurrent();
+		if (!request) {
+			return fireHook(hookId, MENU_LIST_HOOK_TIMEOUT_SECONDS, std::move(aJsonCallback));
+		}
+
+		if (!request->isDispatched()) {
+			// First subscriber, send the hook to everyone
+			request->setDispatched(GET_TICK() + MENU_LIST_HOOK_TIMEOUT_MS);
+			cmm.dispatchMenuListRequest(hookId, aJsonCallback(), *request);
+		}
+
+		auto actionId = request->takePendingAction(this);
+		if (!actionId) {
+			// Subscribed after the request was dispatched
+			return fireHook(hookId, MENU_LIST_HOOK_TIMEOUT_SECONDS, std::move(aJsonCallback));
+		}
+
+		// Late responses are ignored
+		const auto now = GET_TICK();
+		const auto deadline = request->getDeadline();
+		return waitHookAction(hookId, *actionId, deadline > now ? static_cast<int>(deadline - now) : 0);
+	}
+
+	void MenuApi::on(ContextMenuManagerListener::MenuListRequested, const string& aHookId, const json& aData, ContextMenuListRequest& aRequest) noexcept {
+		auto actionId = dispatchHook(aHookId, MENU_LIST_HOOK_TIMEOUT_MS, json(aData));
+		if (!actionId) {
+			return;
+		}
+
+		aRequest.addPendingAction(this, *actionId, [this, id = *actionId] {
+			cancelHookAction(id);
+		});
+	}
+
 	void MenuApi::onMenuItemSelected(const string& aMenuId, const json& aSelectedIds, const ContextMenuItemClickData& aClickData, const json& aEntityId) noexcept {
 		maybeSend(aMenuId + "_menuitem_selected", [&]() {
 			json ret = {
@@ -59,7 +59,7 @@ namespace webserver {
 		template<typename IdT>
 		ActionHookResult<ContextMenuItemList> menuListHookHandler(const vector<IdT>& aSelections, const AccessList& aAccessList, const ActionHookResultGetter<ContextMenuItemList>& aResultGetter, const string& aMenuId, const IdSerializer<IdT>& aIdSerializer, const StringList& aSupports, const json& aEntityId = nullptr) {
 			return HookCompletionData::toResult<ContextMenuItemList>(
-				fireHook(toHookId(aMenuId), 1, [&]() {
+				fireMenuListHook(aMenuId, [&]() {
 					return json({
 						{ "selected_ids", Serializer::serializeList(aSelections, aIdSerializer) },
 						{ "permissions", Serializer::serializePermissions(aAccessList) },
@@ -72,6 +72,10 @@ namespace webserver {
 			);
 		}
 
+		// Results from all subscribers are collected concurrently under a shared deadline 
+		// when called during a ContextMenuManager list request
+		HookCompletionDataPtr fireMenuListHook(const string& aMenuId, JsonCallback&& aJsonCallback) noexcept;
+
 		template<typename IdT>
 		static vector<IdT> deserializeItemIds(ApiRequest& aRequest, const Deserializer::ArrayDeserializerFunc<IdT>& aIdDeserializerFunc) {
 			return Deserializer::deserializeList<IdT>("selected_ids", aRequest.getRequestBody(), aIdDeserializerFunc, false);
@@ -123,6 +127,8 @@ namespace webserver {
 		void on(ContextMenuManagerListener::FilelistItemMenuSelected, const vector<uint32_t>& aSelectedIds, const DirectoryListingPtr& aList, const ContextMenuItemClickData& aClickData) noexcept override;
 		void on(ContextMenuManagerListener::HubUserMenuSelected, const vector<uint32_t>&, const ClientPtr& aClient, const ContextMenuItemClickData& aClickData) noexcept override;
 
+		void on(ContextMenuManagerListener::MenuListRequested, const string& aHookId, const json& aData, ContextMenuListRequest& aRequest) noexcept override;
+
 		void onMenuItemSelected(const string& aMenuId, const json& aSelectedIds, const ContextMenuItemClickData& aClickData, const json& aEntityId = nullptr) noexcept;
 	};
 }
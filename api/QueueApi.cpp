@@ -115,9 +115,14 @@ namespace webserver {
 
 		QueueManager::getInstance()->addListener(this);
 		DownloadManager::getInstance()->addListener(this);
+
+		// Bundle and file events are identical for all sessions
+		joinEventGroup("queue");
 	}
 
 	QueueApi::~QueueApi() {
+		leaveEventGroup();
+
 		QueueManager::getInstance()->removeListener(this);
 		DownloadManager::getInstance()->removeListener(this);
 	}
@@ -531,56 +536,55 @@ namespace webserver {
 	// FILE LISTENERS
 	void QueueApi::on(QueueManagerListener::ItemAdded, const QueueItemPtr& aQI) noexcept {
 		fileView.onItemAdded(aQI);
-		if (!subscriptionActive("queue_file_added"))
-			return;
-
-		send("queue_file_added", Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler));
+		publish("queue_file_added", [&] {
+			return Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler);
+		});
 	}
 
 	void QueueApi::on(QueueManagerListener::ItemRemoved, const QueueItemPtr& aQI, bool /*finished*/) noexcept {
 		fileView.onItemRemoved(aQI);
-		if (!subscriptionActive("queue_file_removed"))
-			return;
-
-		send("queue_file_removed", Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler));
+		publish("queue_file_removed", [&] {
+			return Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler);
+		});
 	}
 
-	void QueueApi::onFileUpdated(const QueueItemPtr& aQI, const PropertyIdSet& aUpdatedProperties, const string& aSubscription) {
+	void QueueApi::onFileUpdated(const QueueItemPtr& aQI, const PropertyIdSet& aUpdatedProperties, SubscriptionId aSubscription) {
 		fileView.onItemUpdated(aQI, aUpdatedProperties);
-		if (subscriptionActive(aSubscription)) {
-			// Serialize full item for more specific updates to make reading of data easier 
-			// (such as cases when the script is interested only in finished files)
-			send(aSubscription, Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler));
-		}
 
-		if (subscriptionActive("queue_file_updated")) {
-			// Serialize updated properties only
-			send("queue_file_updated", Serializer::serializePartialItem(aQI, QueueFileUtils::propertyHandler, aUpdatedProperties));
-		}
+		// Serialize full item for more specific updates to make reading of data easier 
+		// (such as cases when the script is interested only in finished files)
+		publish(aSubscription, [&] {
+			return Serializer::serializeItem(aQI, QueueFileUtils::propertyHandler);
+		});
+
+		// Serialize updated properties only
+		publish(fileUpdatedSubscription, [&] {
+			return Serializer::serializePartialItem(aQI, QueueFileUtils::propertyHandler, aUpdatedProperties);
+		});
 	}
 
 	void QueueApi::on(QueueManagerListener::ItemSources, const QueueItemPtr& aQI) noexcept {
-		onFileUpdated(aQI, { QueueFileUtils::PROP_SOURCES }, "queue_file_sources");
+		onFileUpdated(aQI, { QueueFileUtils::PROP_SOURCES }, getSubscriptionId("queue_file_sources"));
 	}
 
 	void QueueApi::on(QueueManagerListener::ItemStatus, const QueueItemPtr& aQI) noexcept {
 		onFileUpdated(aQI, { 
 			QueueFileUtils::PROP_STATUS, QueueFileUtils::PROP_TIME_FINISHED, QueueFileUtils::PROP_BYTES_DOWNLOADED, 
 			QueueFileUtils::PROP_SECONDS_LEFT, QueueFileUtils::PROP_SPEED 
-		}, "queue_file_status");
+		}, getSubscriptionId("queue_file_status"));
 	}
 
 	void QueueApi::on(QueueManagerListener::ItemPriority, const QueueItemPtr& aQI) noexcept {
 		onFileUpdated(aQI, {
 			QueueFileUtils::PROP_STATUS, QueueFileUtils::PROP_PRIORITY
-		}, "queue_file_priority");
+		}, getSubscriptionId("queue_file_priority"));
 	}
 
 	void QueueApi::on(QueueManagerListener::ItemTick, const QueueItemPtr& aQI) noexcept {
 		onFileUpdated(aQI, {
 			QueueFileUtils::PROP_STATUS, QueueFileUtils::PROP_BYTES_DOWNLOADED,
 			QueueFileUtils::PROP_SECONDS_LEFT, QueueFileUtils::PROP_SPEED
-		}, "queue_file_tick");
+		}, fileTickSubscription);
 	}
 
 	void QueueApi::on(QueueManagerListener::FileRecheckFailed, const QueueItemPtr&, const string&) noexcept {
@@ -591,58 +595,57 @@ namespace webserver {
 	// BUNDLE LISTENERS
 	void QueueApi::on(QueueManagerListener::BundleAdded, const BundlePtr& aBundle) noexcept {
 		bundleView.onItemAdded(aBundle);
-		if (!subscriptionActive("queue_bundle_added"))
-			return;
-
-		send("queue_bundle_added", Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler));
+		publish("queue_bundle_added", [&] {
+			return Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler);
+		});
 	}
 	void QueueApi::on(QueueManagerListener::BundleRemoved, const BundlePtr& aBundle) noexcept {
 		bundleView.onItemRemoved(aBundle);
-		if (!subscriptionActive("queue_bundle_removed"))
-			return;
-
-		send("queue_bundle_removed", Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler));
+		publish("queue_bundle_removed", [&] {
+			return Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler);
+		});
 	}
 
-	void QueueApi::onBundleUpdated(const BundlePtr& aBundle, const PropertyIdSet& aUpdatedProperties, const string& aSubscription) {
+	void QueueApi::onBundleUpdated(const BundlePtr& aBundle, const PropertyIdSet& aUpdatedProperties, SubscriptionId aSubscription) {
 		bundleView.onItemUpdated(aBundle, aUpdatedProperties);
-		if (subscriptionActive(aSubscription)) {
-			// Serialize full item for more specific updates to make reading of data easier 
-			// (such as cases when the script is interested only in finished bundles)
-			send(aSubscription, Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler));
-		}
 
-		if (subscriptionActive("queue_bundle_updated")) {
-			// Serialize updated properties only
-			send("queue_bundle_updated", Serializer::serializePartialItem(aBundle, QueueBundleUtils::propertyHandler, aUpdatedProperties));
-		}
+		// Serialize full item for more specific updates to make reading of data easier 
+		// (such as cases when the script is interested only in finished bundles)
+		publish(aSubscription, [&] {
+			return Serializer::serializeItem(aBundle, QueueBundleUtils::propertyHandler);
+		});
+
+		// Serialize updated properties only
+		publish(bundleUpdatedSubscription, [&] {
+			return Serializer::serializePartialItem(aBundle, QueueBundleUtils::propertyHandler, aUpdatedProperties);
+		});
 	}
 
 	void QueueApi::on(QueueManagerListener::BundleSize, const BundlePtr& aBundle) noexcept {
-		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_SIZE, QueueBundleUtils::PROP_TYPE }, "queue_bundle_content");
+		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_SIZE, QueueBundleUtils::PROP_TYPE }, getSubscriptionId("queue_bundle_content"));
 	}
 
 	void QueueApi::on(QueueManagerListener::BundlePriority, const BundlePtr& aBundle) noexcept {
-		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_PRIORITY, QueueBundleUtils::PROP_STATUS }, "queue_bundle_priority");
+		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_PRIORITY, QueueBundleUtils::PROP_STATUS }, getSubscriptionId("queue_bundle_priority"));
 	}
 
 	void QueueApi::on(QueueManagerListener::BundleStatusChanged, const BundlePtr& aBundle) noexcept {
-		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_STATUS, QueueBundleUtils::PROP_TIME_FINISHED }, "queue_bundle_status");
+		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_STATUS, QueueBundleUtils::PROP_TIME_FINISHED }, getSubscriptionId("queue_bundle_status"));
 	}
 
 	void QueueApi::on(QueueManagerListener::BundleSources, const BundlePtr& aBundle) noexcept {
-		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_SOURCES }, "queue_bundle_sources");
+		onBundleUpdated(aBundle, { QueueBundleUtils::PROP_SOURCES }, getSubscriptionId("queue_bundle_sources"));
 	}
 
 #define TICK_PROPS { QueueBundleUtils::PROP_SECONDS_LEFT, QueueBundleUtils::PROP_SPEED, QueueBundleUtils::PROP_STATUS, QueueBundleUtils::PROP_BYTES_DOWNLOADED }
 	void QueueApi::on(DownloadManagerListener::BundleTick, const BundleList& aTickBundles, uint64_t /*aTick*/) noexcept {
 		for (const auto& b : aTickBundles) {
-			onBundleUpdated(b, TICK_PROPS, "queue_bundle_tick");
+			onBundleUpdated(b, TICK_PROPS, bundleTickSubscription);
 		}
 	}
 
 	void QueueApi::on(DownloadManagerListener::BundleWaiting, const BundlePtr& aBundle) noexcept {
 		// "Waiting" isn't really a status (it's just meant to clear the props for running bundles...)
-		onBundleUpdated(aBundle, TICK_PROPS, "queue_bundle_tick");
+		onBundleUpdated(aBundle, TICK_PROPS, bundleTickSubscription);
 	}
 }
\ No newline at end of file
@@ -40,6 +40,12 @@ namespace webserver {
 		QueueApi(Session* aSession);
 		~QueueApi();
 	private:
+		// Resolve the subscriptions of the tick events only once (the other updates are less frequent)
+		const SubscriptionId bundleUpdatedSubscription = getSubscriptionId("queue_bundle_updated");
+		const SubscriptionId bundleTickSubscription = getSubscriptionId("queue_bundle_tick");
+		const SubscriptionId fileUpdatedSubscription = getSubscriptionId("queue_file_updated");
+		const SubscriptionId fileTickSubscription = getSubscriptionId("queue_file_tick");
+
 		ActionHookResult<> bundleCompletionHook(const BundlePtr& aBundle, const ActionHookResultGetter<>& aResultGetter) noexcept;
 		ActionHookResult<> fileCompletionHook(const QueueItemPtr& aFile, const ActionHookResultGetter<>& aResultGetter) noexcept;
 
@@ -110,8 +116,8 @@ namespace webserver {
 		void on(QueueManagerListener::ItemPriority, const QueueItemPtr& aQI) noexcept override;
 		void on(QueueManagerListener::ItemTick, const QueueItemPtr& aQI) noexcept override;
 
-		void onFileUpdated(const QueueItemPtr& aQI, const PropertyIdSet& aUpdatedProperties, const string& aSubscription);
-		void onBundleUpdated(const BundlePtr& aBundle, const PropertyIdSet& aUpdatedProperties, const string& aSubscription);
+		void onFileUpdated(const QueueItemPtr& aQI, const PropertyIdSet& aUpdatedProperties, SubscriptionId aSubscription);
+		void onBundleUpdated(const BundlePtr& aBundle, const PropertyIdSet& aUpdatedProperties, SubscriptionId aSubscription);
 
 		typedef ListViewController<BundlePtr, QueueBundleUtils::PROP_LAST> BundleListView;
 		BundleListView bundleView;
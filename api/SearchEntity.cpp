@@ -206,12 +206,12 @@ namespace webserver {
 	void SearchEntity::on(SearchInstanceListener::GroupedResultAdded, const GroupedSearchResultPtr& aResult) noexcept {
 		searchView.onItemAdded(aResult);
 
-		if (subscriptionActive("search_result_added")) {
-			send("search_result_added", {
-				{ "search_id", search->getCurrentSearchToken() },
+		publishAsync(resultAddedSubscription, [aResult, searchToken = search->getCurrentSearchToken()] {
+			return json({
+				{ "search_id", searchToken },
 				{ "result", Serializer::serializeItem(aResult, SearchUtils::propertyHandler) }
 			});
-		}
+		});
 	}
 
 	void SearchEntity::on(SearchInstanceListener::ChildResultAdded, const GroupedSearchResultPtr& aResult, const SearchResultPtr&) noexcept {
@@ -221,22 +221,22 @@ namespace webserver {
 			SearchUtils::PROP_USERS
 		});
 		
-		if (subscriptionActive("search_result_updated")) {
-			send("search_result_updated", {
-				{ "search_id", search->getCurrentSearchToken() },
+		publishAsync(resultUpdatedSubscription, [aResult, searchToken = search->getCurrentSearchToken()] {
+			return json({
+				{ "search_id", searchToken },
 				{ "result", Serializer::serializeItem(aResult, SearchUtils::propertyHandler) }
 			});
-		}
+		});
 	}
 
 	void SearchEntity::on(SearchInstanceListener::UserResult, const SearchResultPtr& aResult, const GroupedSearchResultPtr& aParent) noexcept {
-		if (subscriptionActive("search_user_result")) {
-			send("search_user_result", {
-				{ "search_id", search->getCurrentSearchToken() },
+		publishAsync(userResultSubscription, [aResult, aParent, searchToken = search->getCurrentSearchToken()] {
+			return json({
+				{ "search_id", searchToken },
 				{ "parent_id", aParent->getToken() },
 				{ "result", serializeSearchResult(aResult) }
 			});
-		}
+		});
 	}
 
 	void SearchEntity::on(SearchInstanceListener::Reset) noexcept {
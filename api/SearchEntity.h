@@ -49,6 +49,11 @@ namespace webserver {
 
 		static json serializeSearchQuery(const SearchPtr& aQuery) noexcept;
 	private:
+		// Result events are fired frequently, resolve the subscriptions only once
+		const SubscriptionId resultAddedSubscription = getSubscriptionId("search_result_added");
+		const SubscriptionId resultUpdatedSubscription = getSubscriptionId("search_result_updated");
+		const SubscriptionId userResultSubscription = getSubscriptionId("search_user_result");
+
 		const SearchInstancePtr search;
 
 		GroupedSearchResultList getResultList() noexcept;
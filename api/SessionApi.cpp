@@ -232,7 +232,9 @@ namespace webserver {
 			{ "type", getSessionType(aSession) },
 			{ "last_activity", GET_TICK() - aSession->getLastActivity() },
 			{ "ip", aSession->getIp() },
-			{ "user", Serializer::serializeItem(aSession->getUser(), WebUserUtils::propertyHandler) }
+			{ "user", Serializer::serializeItem(aSession->getUser(), WebUserUtils::propertyHandler) },
+			{ "executor", aSession->getExecutor().getStats().toJson() },
+			{ "rate_limits", aSession->getRateLimitStats() },
 		};
 	}
 
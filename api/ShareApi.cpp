@@ -30,7 +30,7 @@
 #include <web-server/JsonUtil.h>
 
 #include <airdcpp/ClientManager.h>
-#include <airdcpp/HashManager.h>
+#include <airdcpp/File.h>
 #include <airdcpp/HubEntry.h>
 #include <airdcpp/Magnet.h>
 #include <airdcpp/SearchResult.h>
@@ -104,9 +104,16 @@ namespace webserver {
 		ShareManager::getInstance()->removeListener(this);
 	}
 
+	string ShareApi::getValidationCacheKey(const string& aPath, int64_t aSize) noexcept {
+		// Include the modification time so that changed items will be validated again
+		return aPath + "|" + Util::toString(aSize) + "|" + Util::toString(File::getLastModified(aPath));
+	}
+
 	ActionHookResult<> ShareApi::fileValidationHook(const string& aPath, int64_t aSize, const ActionHookResultGetter<>& aResultGetter) noexcept {
 		return HookCompletionData::toResult(
-			fireHook("share_file_validation_hook", 30, [&]() {
+			fireCachedHook("share_file_validation_hook", [&]() {
+				return getValidationCacheKey(aPath, aSize);
+			}, 30, [&]() {
 				return json({
 					{ "path", aPath },
 					{ "size", aSize },
@@ -118,7 +125,9 @@ namespace webserver {
 
 	ActionHookResult<> ShareApi::directoryValidationHook(const string& aPath, const ActionHookResultGetter<>& aResultGetter) noexcept {
 		return HookCompletionData::toResult(
-			fireHook("share_directory_validation_hook", 30, [&]() {
+			fireCachedHook("share_directory_validation_hook", [&]() {
+				return getValidationCacheKey(aPath, -1);
+			}, 30, [&]() {
 				return json({
 					{ "path", aPath },
 				});
@@ -129,7 +138,9 @@ namespace webserver {
 
 	ActionHookResult<> ShareApi::newDirectoryValidationHook(const string& aPath, bool aNewParent, const ActionHookResultGetter<>& aResultGetter) noexcept {
 		return HookCompletionData::toResult(
-			fireHook("new_share_directory_validation_hook", 60, [&]() {
+			fireCachedHook("new_share_directory_validation_hook", [&]() {
+				return getValidationCacheKey(aPath, -1) + (aNewParent ? "|1" : "|0");
+			}, 60, [&]() {
 				return json({
 					{ "path", aPath },
 					{ "new_parent", aNewParent },
@@ -142,7 +153,9 @@ namespace webserver {
 
 	ActionHookResult<> ShareApi::newFileValidationHook(const string& aPath, int64_t aSize, bool aNewParent, const ActionHookResultGetter<>& aResultGetter) noexcept {
 		return HookCompletionData::toResult(
-			fireHook("new_share_file_validation_hook", 60, [&]() {
+			fireCachedHook("new_share_file_validation_hook", [&]() {
+				return getValidationCacheKey(aPath, aSize) + (aNewParent ? "|1" : "|0");
+			}, 60, [&]() {
 				return json({
 					{ "path", aPath },
 					{ "size", aSize },
@@ -204,27 +217,16 @@ namespace webserver {
 		const auto user = Deserializer::deserializeUser(aRequest.getRequestBody(), false, true);
 		const auto client = Deserializer::deserializeClient(aRequest.getRequestBody());
 
-		const auto filePath = aRequest.getSession()->getServer()->getFileServer().getTempFilePath(fileId);
-		if (filePath.empty() || !Util::fileExists(filePath)) {
+		// The TTH was calculated when the file was uploaded
+		const auto tempFile = aRequest.getSession()->getServer()->getFileServer().getTempFile(fileId);
+		if (!tempFile || !Util::fileExists(tempFile->path)) {
 			aRequest.setResponseErrorStr("File with an ID " + fileId + " was not found");
 			return websocketpp::http::status_code::bad_request;
 		}
 
-		const auto size = File::getSize(filePath);
-		TTHValue tth;
-
-		{
-			int64_t sizeLeft = 0;
-			bool cancelHashing = false;
-
-			// Calculate TTH
-			try {
-				HashManager::getInstance()->getFileTTH(filePath, size, true, tth, sizeLeft, cancelHashing);
-			} catch (const Exception& e) {
-				aRequest.setResponseErrorStr("Failed to calculate file TTH: " + e.getError());
-				return websocketpp::http::status_code::internal_server_error;
-			}
-		}
+		const auto& filePath = tempFile->path;
+		const auto size = tempFile->size;
+		const auto& tth = tempFile->tth;
 
 		auto item = ShareManager::getInstance()->addTempShare(tth, name, filePath, size, client->get(HubSettings::ShareProfile), user);
 
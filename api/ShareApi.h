@@ -35,6 +35,8 @@ namespace webserver {
 		ActionHookResult<> newDirectoryValidationHook(const string& aPath, bool aNewParent, const ActionHookResultGetter<>& aResultGetter) noexcept;
 		ActionHookResult<> newFileValidationHook(const string& aPath, int64_t aSize, bool aNewParent, const ActionHookResultGetter<>& aResultGetter) noexcept;
 
+		static string getValidationCacheKey(const string& aPath, int64_t aSize) noexcept;
+
 		api_return handleRefreshShare(ApiRequest& aRequest);
 		api_return handleRefreshPaths(ApiRequest& aRequest);
 		api_return handleRefreshVirtual(ApiRequest& aRequest);
@@ -39,6 +39,7 @@ namespace webserver {
 	SystemApi::SystemApi(Session* aSession) : SubscribableApiModule(aSession, Access::ANY, { "away_state" }) {
 
 		METHOD_HANDLER(Access::ANY, METHOD_GET,		(EXACT_PARAM("stats")),			SystemApi::handleGetStats);
+		METHOD_HANDLER(Access::ADMIN, METHOD_GET,	(EXACT_PARAM("metrics")),		SystemApi::handleGetMetrics);
 
 		METHOD_HANDLER(Access::ANY, METHOD_GET,		(EXACT_PARAM("away")),			SystemApi::handleGetAwayState);
 		METHOD_HANDLER(Access::ANY, METHOD_POST,	(EXACT_PARAM("away")),			SystemApi::handleSetAway);
@@ -133,10 +134,18 @@ namespace webserver {
 		aRequest.setResponseBody({
 			{ "server_threads", WEBCFG(SERVER_THREADS).num() },
 			{ "active_sessions", server->getUserManager().getUserSessionCount() },
+			{ "event_queue", server->getEventBus().getQueueStats() },
+			{ "task_queues", server->getTaskQueueStats() },
+			{ "task_pools", server->getTaskPoolStats() },
 		});
 		return websocketpp::http::status_code::ok;
 	}
 
+	api_return SystemApi::handleGetMetrics(ApiRequest& aRequest) {
+		aRequest.setResponseBody(session->getServer()->getApiMetrics().toJson());
+		return websocketpp::http::status_code::ok;
+	}
+
 	json SystemApi::getSystemInfo() noexcept {
 		auto started = TimerManager::getStartTime();
 		return {
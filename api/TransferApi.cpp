@@ -66,11 +66,16 @@ namespace webserver {
 		DownloadManager::getInstance()->addListener(this);
 		UploadManager::getInstance()->addListener(this);
 		TransferInfoManager::getInstance()->addListener(this);
+
+		// Transfer events are identical for all sessions
+		joinEventGroup("transfers");
 	}
 
 	TransferApi::~TransferApi() {
 		timer->stop(true);
 
+		leaveEventGroup();
+
 		DownloadManager::getInstance()->removeListener(this);
 		UploadManager::getInstance()->removeListener(this);
 		TransferInfoManager::getInstance()->removeListener(this);
@@ -194,9 +199,9 @@ namespace webserver {
 
 	void TransferApi::on(TransferInfoManagerListener::Added, const TransferInfoPtr& aInfo) noexcept {
 		view.onItemAdded(aInfo);
-		if (subscriptionActive("transfer_added")) {
-			send("transfer_added", Serializer::serializeItem(aInfo, TransferUtils::propertyHandler));
-		}
+		publishAsync(transferAddedSubscription, [aInfo] {
+			return Serializer::serializeItem(aInfo, TransferUtils::propertyHandler);
+		});
 	}
 
 	PropertyIdSet TransferApi::updateFlagsToPropertyIds(int aUpdatedProperties) noexcept {
@@ -238,33 +243,33 @@ namespace webserver {
 		auto updatedProps = updateFlagsToPropertyIds(aUpdatedProperties);
 
 		view.onItemUpdated(aInfo, updatedProps);
-		if (subscriptionActive("transfer_updated")) {
-			send("transfer_updated", Serializer::serializePartialItem(aInfo, TransferUtils::propertyHandler, updatedProps));
-		}
+		publishAsync(transferUpdatedSubscription, [aInfo, updatedProps] {
+			return Serializer::serializePartialItem(aInfo, TransferUtils::propertyHandler, updatedProps);
+		});
 	}
 
 	void TransferApi::on(TransferInfoManagerListener::Removed, const TransferInfoPtr& aInfo) noexcept {
 		view.onItemRemoved(aInfo);
-		if (subscriptionActive("transfer_removed")) {
-			send("transfer_removed", Serializer::serializeItem(aInfo, TransferUtils::propertyHandler));
-		}
+		publishAsync(transferRemovedSubscription, [aInfo] {
+			return Serializer::serializeItem(aInfo, TransferUtils::propertyHandler);
+		});
 	}
 
 	void TransferApi::on(TransferInfoManagerListener::Failed, const TransferInfoPtr& aInfo) noexcept { 
-		if (subscriptionActive("transfer_failed")) {
-			send("transfer_failed", Serializer::serializeItem(aInfo, TransferUtils::propertyHandler));
-		}
+		publishAsync(transferFailedSubscription, [aInfo] {
+			return Serializer::serializeItem(aInfo, TransferUtils::propertyHandler);
+		});
 	}
 
 	void TransferApi::on(TransferInfoManagerListener::Starting, const TransferInfoPtr& aInfo) noexcept {
-		if (subscriptionActive("transfer_starting")) {
-			send("transfer_starting", Serializer::serializeItem(aInfo, TransferUtils::propertyHandler));
-		}
+		publishAsync(transferStartingSubscription, [aInfo] {
+			return Serializer::serializeItem(aInfo, TransferUtils::propertyHandler);
+		});
 	}
 
 	void TransferApi::on(TransferInfoManagerListener::Completed, const TransferInfoPtr& aInfo) noexcept {
-		if (subscriptionActive("transfer_completed")) {
-			send("transfer_completed", Serializer::serializeItem(aInfo, TransferUtils::propertyHandler));
-		}
+		publishAsync(transferCompletedSubscription, [aInfo] {
+			return Serializer::serializeItem(aInfo, TransferUtils::propertyHandler);
+		});
 	}
 }
\ No newline at end of file
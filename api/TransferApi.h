@@ -39,6 +39,14 @@ namespace webserver {
 		TransferApi(Session* aSession);
 		~TransferApi();
 	private:
+		// Transfer events are fired frequently, resolve the subscriptions only once
+		const SubscriptionId transferAddedSubscription = getSubscriptionId("transfer_added");
+		const SubscriptionId transferUpdatedSubscription = getSubscriptionId("transfer_updated");
+		const SubscriptionId transferRemovedSubscription = getSubscriptionId("transfer_removed");
+		const SubscriptionId transferStartingSubscription = getSubscriptionId("transfer_starting");
+		const SubscriptionId transferCompletedSubscription = getSubscriptionId("transfer_completed");
+		const SubscriptionId transferFailedSubscription = getSubscriptionId("transfer_failed");
+
 		json serializeTransferStats() const noexcept;
 
 		api_return handleGetTransfers(ApiRequest& aRequest);
@@ -33,46 +33,99 @@ namespace webserver {
 
 	}
 
-	optional<ApiRequest::NamedParamMap> ApiModule::RequestHandler::matchParams(const ApiRequest::PathTokenList& aPathTokens) const noexcept {
+	bool ApiModule::RequestHandler::Param::matches(std::string_view aToken) const noexcept {
+		if (aToken.empty()) {
+			return false;
+		}
+
+		switch (type) {
+			case TYPE_EXACT: return aToken == id;
+			case TYPE_NUMERIC: return all_of(aToken.begin(), aToken.end(), [](char c) {
+				return c >= '0' && c <= '9';
+			});
+			case TYPE_HASH: return aToken.size() == 39 && all_of(aToken.begin(), aToken.end(), [](char c) {
+				return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z');
+			});
+			case TYPE_WORD: return all_of(aToken.begin(), aToken.end(), [](char c) {
+				return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+			});
+			case TYPE_REGEX: {
+				try {
+					return boost::regex_search(aToken.begin(), aToken.end(), reg);
+				} catch (const std::runtime_error&) {
+					return false;
+				}
+			}
+		}
+
+		dcassert(0);
+		return false;
+	}
+
+	bool ApiModule::RequestHandler::matchParams(const ApiRequest::PathTokenList& aPathTokens, ApiRequest::NamedParamList& params_) const noexcept {
 		if (method == METHOD_FORWARD) {
 			if (aPathTokens.size() < params.size()) {
-				return nullopt;
+				return false;
 			}
 		} else if (aPathTokens.size() != params.size()) {
-			return nullopt;
+			return false;
 		}
 
 		for (auto i = 0; i < static_cast<int>(params.size()); i++) {
-			try {
-				if (!boost::regex_search(aPathTokens[i], params[i].reg)) {
-					return nullopt;
-				}
-			} catch (const std::runtime_error&) {
-				return nullopt;
+			if (!params[i].matches(aPathTokens[i])) {
+				return false;
 			}
 		}
 
-		ApiRequest::NamedParamMap paramMap;
+		params_.clear();
 		for (auto i = 0; i < static_cast<int>(params.size()); i++) {
-			paramMap[params[i].id] = aPathTokens[i];
+			params_.emplace_back(params[i].id, aPathTokens[i]);
+		}
+
+		return true;
+	}
+
+	string ApiModule::RequestHandler::formatRoutePattern(const ParamList& aParams) noexcept {
+		string ret;
+		for (const auto& p: aParams) {
+			if (!ret.empty()) {
+				ret += "/";
+			}
+
+			if (p.type == Param::TYPE_EXACT) {
+				// Exact match
+				ret += p.id;
+			} else {
+				ret += "{" + p.id + "}";
+			}
+		}
+
+		return ret;
+	}
+
+	int ApiModule::RequestHandler::getRouteId(const ApiRequest& aRequest) const noexcept {
+		auto id = routeId.load(std::memory_order_relaxed);
+		if (id == -1) {
+			id = WebServerManager::getInstance()->getApiMetrics().getRouteId(aRequest.getRouteId(), aRequest.getApiModule(), routePattern);
+			routeId.store(id, std::memory_order_relaxed);
 		}
 
-		return paramMap;
+		return id;
 	}
 
 	api_return ApiModule::handleRequest(ApiRequest& aRequest) {
 		bool hasParamNameMatch = false; // for better error reporting
 
 		// Match parameters
+		ApiRequest::NamedParamList namedParams;
 		auto handler = find_if(requestHandlers.begin(), requestHandlers.end(), [&](const RequestHandler& aHandler) {
 			// Regular matching
-			auto namedParams = aHandler.matchParams(aRequest.getPathTokens());
-			if (!namedParams) {
+			if (!aHandler.matchParams(aRequest.getPathTokens(), namedParams)) {
 				return false;
 			}
 
 			if (aHandler.method == aRequest.getMethod() || aHandler.method == METHOD_FORWARD) {
-				aRequest.setNamedParams(*namedParams);
+				aRequest.setNamedParams(namedParams);
 				return true;
 			}
 
@@ -90,6 +143,8 @@ namespace webserver {
 			return websocketpp::http::status_code::bad_request;
 		}
 
+		aRequest.setRouteId(handler->getRouteId(aRequest));
+
 		// Check permission
 		if (!session->getUser()->hasPermission(handler->access)) {
 			aRequest.setResponseErrorStr("The permission " + WebUser::accessToString(handler->access) + " is required for accessing this method");
@@ -131,7 +186,7 @@ namespace webserver {
 		socket = WebServerManager::getInstance()->getSocket(aSession->getId());
 
 		for (const auto& s: aSubscriptions) {
-			subscriptions.emplace(s, false);
+			SubscribableApiModule::createSubscription(s);
 		}
 
 		aSession->addListener(this);
@@ -141,6 +196,8 @@ namespace webserver {
 	}
 
 	SubscribableApiModule::~SubscribableApiModule() {
+		leaveEventGroup();
+
 		session->removeListener(this);
 		socket = nullptr;
 	}
@@ -151,13 +208,36 @@ namespace webserver {
 
 	void SubscribableApiModule::on(SessionListener::SocketDisconnected) noexcept {
 		// Disable all subscriptions
-		for (auto& s : subscriptions) {
-			s.second = false;
-		}
+		subscriptionStates.store(0, std::memory_order_release);
 
 		socket = nullptr;
 	}
 
+	void SubscribableApiModule::createSubscription(const string& aSubscription) {
+		dcassert(subscriptionIds.find(aSubscription) == subscriptionIds.end());
+		if (static_cast<SubscriptionId>(subscriptionNames.size()) >= MAX_SUBSCRIPTIONS) {
+			throw std::length_error("Too many subscriptions for a single module (" + aSubscription + ")");
+		}
+
+		auto id = static_cast<SubscriptionId>(subscriptionNames.size());
+		subscriptionIds.emplace(aSubscription, id);
+		subscriptionNames.push_back(aSubscription);
+	}
+
+	void SubscribableApiModule::setSubscriptionState(const string& aSubscription, bool aActive) noexcept {
+		auto id = getSubscriptionId(aSubscription);
+		if (id == INVALID_SUBSCRIPTION) {
+			dcassert(0);
+			return;
+		}
+
+		if (aActive) {
+			subscriptionStates.fetch_or(subscriptionMask(id), std::memory_order_acq_rel);
+		} else {
+			subscriptionStates.fetch_and(~subscriptionMask(id), std::memory_order_acq_rel);
+		}
+	}
+
 	api_return SubscribableApiModule::handleSubscribe(ApiRequest& aRequest) {
 		if (!socket) {
 			aRequest.setResponseErrorStr("Socket required");
@@ -209,10 +289,130 @@ namespace webserver {
 	}
 
 	bool SubscribableApiModule::maybeSend(const string& aSubscription, JsonCallback aCallback) {
+		dcassert(subscriptionExists(aSubscription));
+		return maybeSend(getSubscriptionId(aSubscription), aCallback);
+	}
+
+	bool SubscribableApiModule::maybeSend(SubscriptionId aSubscription, JsonCallback aCallback) {
 		if (!subscriptionActive(aSubscription)) {
 			return false;
 		}
 
-		return send(aSubscription, aCallback());
+		return send(getSubscriptionName(aSubscription), aCallback());
+	}
+
+	bool SubscribableApiModule::sendSerialized(const string& aData) noexcept {
+		auto s = socket;
+		if (!s) {
+			return false;
+		}
+
+		s->sendSerialized(aData);
+		return true;
+	}
+
+	void SubscribableApiModule::joinEventGroup(const string& aGroup) noexcept {
+		dcassert(eventGroup.empty());
+		eventGroup = aGroup;
+		session->getServer()->getEventBus().addModule(eventGroup, this);
+	}
+
+	void SubscribableApiModule::leaveEventGroup() noexcept {
+		if (eventGroup.empty()) {
+			return;
+		}
+
+		session->getServer()->getEventBus().removeModule(eventGroup, this);
+		eventGroup.clear();
+	}
+
+	bool SubscribableApiModule::publish(const string& aSubscription, JsonCallback aCallback) {
+		dcassert(subscriptionExists(aSubscription));
+		return publish(getSubscriptionId(aSubscription), aCallback);
+	}
+
+	bool SubscribableApiModule::publish(SubscriptionId aSubscription, JsonCallback aCallback) {
+		if (eventGroup.empty()) {
+			return maybeSend(aSubscription, aCallback);
+		}
+
+		// Another module will send the event to us unless we are the publisher
+		return session->getServer()->getEventBus().publish(eventGroup, this, aSubscription, aCallback, getEventEntityId()) > 0;
+	}
+
+	void SubscribableApiModule::publishAsync(const string& aSubscription, JsonCallback&& aCallback) noexcept {
+		dcassert(subscriptionExists(aSubscription));
+		publishAsync(getSubscriptionId(aSubscription), move(aCallback));
+	}
+
+	void SubscribableApiModule::publishAsync(SubscriptionId aSubscription, JsonCallback&& aCallback) noexcept {
+		auto start = std::chrono::steady_clock::now();
+
+		// Decide the receivers now, the publisher of the group may change before the queue is processed
+		auto& eventBus = session->getServer()->getEventBus();
+		auto group = eventGroup;
+		if (!group.empty()) {
+			if (!eventBus.hasReceivers(group, this, aSubscription)) {
+				return;
+			}
+		} else if (!subscriptionActive(aSubscription)) {
+			return;
+		}
+
+		QueuedEvent event { aSubscription, move(aCallback), move(group) };
+
+		bool scheduleSend = false;
+		size_t queueSize = 0;
+
+		{
+			Lock l(eventQueueCS);
+			eventQueue.push_back(move(event));
+			queueSize = eventQueue.size();
+
+			if (!eventQueueScheduled) {
+				eventQueueScheduled = true;
+				scheduleSend = true;
+			}
+		}
+
+		if (scheduleSend) {
+			addAsyncTask([this] {
+				sendQueuedEvents();
+			});
+		}
+
+		auto captureTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		eventBus.onEventQueued(static_cast<uint64_t>(captureTime.count()), queueSize);
+	}
+
+	void SubscribableApiModule::sendQueuedEvents() noexcept {
+		auto& eventBus = session->getServer()->getEventBus();
+		for (;;) {
+			EventQueue events;
+
+			{
+				Lock l(eventQueueCS);
+				if (eventQueue.empty()) {
+					eventQueueScheduled = false;
+					return;
+				}
+
+				events.swap(eventQueue);
+			}
+
+			// Keep the original order
+			for (const auto& e: events) {
+				try {
+					if (!e.eventGroup.empty()) {
+						// We were the publisher when the event was fired
+						eventBus.send(e.eventGroup, this, e.subscription, e.callback, getEventEntityId());
+					} else if (subscriptionActive(e.subscription)) {
+						send(getSubscriptionName(e.subscription), e.callback());
+					}
+				} catch (const std::exception& ex) {
+					dcdebug("Failed to send queued event %s: %s\n", getSubscriptionName(e.subscription).c_str(), ex.what());
+				}
+			}
+		}
 	}
-}
\ No newline at end of file
+}
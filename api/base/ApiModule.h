@@ -23,6 +23,8 @@
 #include <web-server/ApiRequest.h>
 #include <web-server/SessionListener.h>
 
+#include <airdcpp/CriticalSection.h>
+
 namespace webserver {
 	using boost::regex;
 
@@ -33,20 +35,17 @@ namespace webserver {
 #define MAX_COUNT "max_count_param"
 #define START_POS "start_pos_param"
 
-#define TTH_REG regex(R"(^[0-9A-Z]{39}$)")
-#define CID_REG TTH_REG
-#define TOKEN_REG regex(R"(^\d+$)")
-
-#define NUM_PARAM(id) (ApiModule::RequestHandler::Param(id, TOKEN_REG))
+// Common parameter types are matched without regex
+#define NUM_PARAM(id) (ApiModule::RequestHandler::Param(id, ApiModule::RequestHandler::Param::TYPE_NUMERIC))
 #define TOKEN_PARAM NUM_PARAM(TOKEN_PARAM_ID)
 #define RANGE_START_PARAM NUM_PARAM(START_POS)
 #define RANGE_MAX_PARAM NUM_PARAM(MAX_COUNT)
 
-#define TTH_PARAM (ApiModule::RequestHandler::Param(TTH_PARAM_ID, TTH_REG))
-#define CID_PARAM (ApiModule::RequestHandler::Param(CID_PARAM_ID, CID_REG))
+#define TTH_PARAM (ApiModule::RequestHandler::Param(TTH_PARAM_ID, ApiModule::RequestHandler::Param::TYPE_HASH))
+#define CID_PARAM (ApiModule::RequestHandler::Param(CID_PARAM_ID, ApiModule::RequestHandler::Param::TYPE_HASH))
 
-#define STR_PARAM(id) (ApiModule::RequestHandler::Param(id, regex(R"(^\w+$)")))
-#define EXACT_PARAM(pattern) (ApiModule::RequestHandler::Param(pattern, regex("^" + string(pattern) + "$")))
+#define STR_PARAM(id) (ApiModule::RequestHandler::Param(id, ApiModule::RequestHandler::Param::TYPE_WORD))
+#define EXACT_PARAM(pattern) (ApiModule::RequestHandler::Param(pattern, ApiModule::RequestHandler::Param::TYPE_EXACT))
 
 #define BRACED_INIT_LIST(...) {__VA_ARGS__}
 #define MODULE_METHOD_HANDLER(module, access, method, params, func) (module->getRequestHandlers().push_back(ApiModule::RequestHandler(access, method, BRACED_INIT_LIST params, std::bind(&func, this, placeholders::_1))))
@@ -59,9 +58,21 @@ namespace webserver {
 
 		struct RequestHandler {
 			struct Param {
-				Param(string aParamId, regex&& aReg) : id(std::move(aParamId)), reg(std::move(aReg)) { }
+				enum Type {
+					TYPE_EXACT, // Token must equal to the param ID
+					TYPE_NUMERIC, // ^\d+$
+					TYPE_HASH, // TTH/CID, ^[0-9A-Z]{39}$
+					TYPE_WORD, // ^\w+$
+					TYPE_REGEX
+				};
+
+				Param(string aParamId, Type aType) : id(std::move(aParamId)), type(aType) { }
+				Param(string aParamId, regex&& aReg) : id(std::move(aParamId)), type(TYPE_REGEX), reg(std::move(aReg)) { }
+
+				bool matches(std::string_view aToken) const noexcept;
 
 				string id;
+				Type type;
 				regex reg;
 			};
 
@@ -71,16 +82,33 @@ namespace webserver {
 
 			// Regular handler
 			RequestHandler(Access aAccess, RequestMethod aMethod, ParamList&& aParams, HandlerFunction aFunction) :
-				method(aMethod), params(std::move(aParams)), f(aFunction), access(aAccess) {
+				method(aMethod), params(std::move(aParams)), routePattern(formatRoutePattern(params)), f(aFunction), access(aAccess) {
 			
 			}
 
+			RequestHandler(const RequestHandler& aHandler) :
+				method(aHandler.method), params(aHandler.params), routePattern(aHandler.routePattern), f(aHandler.f), access(aHandler.access), routeId(aHandler.routeId.load()) {
+
+			}
+
 			const RequestMethod method;
 			const ParamList params;
+
+			// Path of the handler with parameter names instead of values (used for metrics)
+			const string routePattern;
 			const HandlerFunction f;
 			const Access access;
 
-			optional<ApiRequest::NamedParamMap> matchParams(const ApiRequest::PathTokenList& aPathTokens) const noexcept;
+			// The returned parameters refer to the names of this handler and to the supplied path tokens
+			bool matchParams(const ApiRequest::PathTokenList& aPathTokens, ApiRequest::NamedParamList& params_) const noexcept;
+
+			// Interned route of the handler (the route of the request must contain the parent handlers)
+			int getRouteId(const ApiRequest& aRequest) const noexcept;
+		private:
+			static string formatRoutePattern(const ParamList& aParams) noexcept;
+
+			// A handler is always reached via the same parent handlers so the route is resolved only once
+			mutable atomic<int> routeId { -1 };
 		};
 
 		typedef std::vector<RequestHandler> RequestHandlerList;
@@ -118,37 +146,67 @@ namespace webserver {
 		SubscribableApiModule(Session* aSession, Access aSubscriptionAccess, const StringList& aSubscriptions);
 		virtual ~SubscribableApiModule();
 
-		typedef std::map<const string, bool> SubscriptionMap;
-
 		virtual bool send(const json& aJson);
 		virtual bool send(const string& aSubscription, const json& aJson);
 
 		typedef std::function<json()> JsonCallback;
-		virtual bool maybeSend(const string& aSubscription, JsonCallback aCallback);
+		bool maybeSend(const string& aSubscription, JsonCallback aCallback);
+		bool maybeSend(SubscriptionId aSubscription, JsonCallback aCallback);
+
+		// Send an event that has been serialized already
+		bool sendSerialized(const string& aData) noexcept;
+
+		// Send an event to the subscribers of all sessions via the shared event bus (the event is serialized only once)
+		// Falls back to maybeSend if the module hasn't joined an event group
+		bool publish(const string& aSubscription, JsonCallback aCallback);
+		bool publish(SubscriptionId aSubscription, JsonCallback aCallback);
+
+		// Queue an event to be serialized and published by the web server task threads
+		// Core listeners should use this to avoid serializing and writing to sockets while core locks are being held
+		// The receivers are decided immediately but the callback is run on the task threads, so it should 
+		// only capture immutable values or snapshots of the entities at the time when the event was fired
+		void publishAsync(const string& aSubscription, JsonCallback&& aCallback) noexcept;
+		void publishAsync(SubscriptionId aSubscription, JsonCallback&& aCallback) noexcept;
 
 		// All custom async tasks should be run inside this to
 		// ensure that the session won't get deleted
 
-		virtual void setSubscriptionState(const string& aSubscription, bool active) noexcept {
-			subscriptions[aSubscription] = active;
+		// Subscription names are interned to small per-module ids when the module is constructed
+		// Modules should resolve the ids of their frequent events once and use them instead of the names
+		// The subscription states are kept in an atomic bitset so that they can be toggled and checked from any thread
+		static constexpr SubscriptionId INVALID_SUBSCRIPTION = -1;
+		static constexpr SubscriptionId MAX_SUBSCRIPTIONS = 64;
+
+		// Returns INVALID_SUBSCRIPTION for unknown names
+		SubscriptionId getSubscriptionId(const string& aSubscription) const noexcept {
+			auto i = subscriptionIds.find(aSubscription);
+			return i != subscriptionIds.end() ? i->second : INVALID_SUBSCRIPTION;
+		}
+
+		const string& getSubscriptionName(SubscriptionId aId) const noexcept {
+			return subscriptionNames[aId];
 		}
 
-		virtual bool subscriptionActive(const string& aSubscription) const noexcept {
-			auto s = subscriptions.find(aSubscription);
-			dcassert(s != subscriptions.end());
-			return s->second;
+		virtual void setSubscriptionState(const string& aSubscription, bool active) noexcept;
+
+		virtual bool subscriptionActive(SubscriptionId aId) const noexcept {
+			return (subscriptionStates.load(std::memory_order_acquire) & subscriptionMask(aId)) != 0;
 		}
 
-		virtual bool subscriptionExists(const string& aSubscription) const noexcept {
-			auto i = subscriptions.find(aSubscription);
-			return i != subscriptions.end();
+		bool subscriptionActive(const string& aSubscription) const noexcept {
+			auto id = getSubscriptionId(aSubscription);
+			dcassert(id != INVALID_SUBSCRIPTION);
+			return id != INVALID_SUBSCRIPTION && subscriptionActive(id);
 		}
 
-		virtual void createSubscription(const string& aSubscription) noexcept {
-			dcassert(subscriptions.find(aSubscription) == subscriptions.end());
-			subscriptions[aSubscription];
+		bool subscriptionExists(const string& aSubscription) const noexcept {
+			return getSubscriptionId(aSubscription) != INVALID_SUBSCRIPTION;
 		}
 
+		// Subscriptions may only be created while the module is being constructed
+		// Throws std::length_error if the module has MAX_SUBSCRIPTIONS subscriptions already
+		virtual void createSubscription(const string& aSubscription);
+
 		Access getSubscriptionAccess() const noexcept {
 			return subscriptionAccess;
 		}
@@ -164,9 +222,46 @@ namespace webserver {
 
 		virtual api_return handleSubscribe(ApiRequest& aRequest);
 		virtual api_return handleUnsubscribe(ApiRequest& aRequest);
+
+		// Modules receiving events from the same core source should use the same group
+		// The group must be joined after the core listener has been added and left before the listener is removed
+		void joinEventGroup(const string& aGroup) noexcept;
+		void leaveEventGroup() noexcept;
+
+		// ID of the entity that is added in events published via the event bus
+		virtual json getEventEntityId() const noexcept {
+			return nullptr;
+		}
 	private:
 		WebSocketPtr socket = nullptr;
-		SubscriptionMap subscriptions;
+
+		static uint64_t subscriptionMask(SubscriptionId aId) noexcept {
+			return aId >= 0 && aId < MAX_SUBSCRIPTIONS ? static_cast<uint64_t>(1) << aId : 0;
+		}
+
+		// Immutable after the module has been constructed
+		typedef std::unordered_map<string, SubscriptionId> SubscriptionIdMap;
+		SubscriptionIdMap subscriptionIds;
+		StringList subscriptionNames;
+
+		atomic<uint64_t> subscriptionStates { 0 };
+
+		string eventGroup;
+
+		void sendQueuedEvents() noexcept;
+
+		struct QueuedEvent {
+			SubscriptionId subscription;
+			JsonCallback callback;
+
+			// Set if the event was published via the event bus
+			string eventGroup;
+		};
+
+		typedef vector<QueuedEvent> EventQueue;
+		EventQueue eventQueue;
+		bool eventQueueScheduled = false;
+		CriticalSection eventQueueCS;
 	};
 
 	typedef std::unique_ptr<ApiModule> HandlerPtr;
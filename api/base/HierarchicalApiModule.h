@@ -181,7 +181,17 @@ namespace webserver {
 		// aId = ID of the entity owning this module
 		// Will inherit access from the parent module
 		SubApiModule(ParentType* aParentModule, const IdJsonType& aJsonId, const StringList& aSubscriptions) :
-			SubscribableApiModule(aParentModule->getSession(), aParentModule->getSubscriptionAccess(), aSubscriptions), parentModule(aParentModule), jsonId(aJsonId) { }
+			SubscribableApiModule(aParentModule->getSession(), aParentModule->getSubscriptionAccess(), aSubscriptions), parentModule(aParentModule), jsonId(aJsonId) {
+
+			// Map our subscription ids to the ones used by the parent for the subscriptions across all entities
+			for (const auto& s: aSubscriptions) {
+				dcassert(getSubscriptionId(s) == static_cast<SubscriptionId>(parentSubscriptionIds.size()));
+				parentSubscriptionIds.push_back(aParentModule->getSubscriptionId(s));
+				dcassert(parentSubscriptionIds.back() != INVALID_SUBSCRIPTION);
+			}
+		}
+
+		using SubscribableApiModule::subscriptionActive;
 
 		bool send(const string& aSubscription, const json& aJson) override {
 			return SubscribableApiModule::send({
@@ -191,22 +201,23 @@ namespace webserver {
 			});
 		}
 
-		bool maybeSend(const string& aSubscription, SubscribableApiModule::JsonCallback aCallback) override {
-			if (!subscriptionActive(aSubscription)) {
+		json getEventEntityId() const noexcept override {
+			return jsonId;
+		}
+
+		bool subscriptionActive(SubscriptionId aId) const noexcept override {
+			if (aId == INVALID_SUBSCRIPTION) {
+				dcassert(0);
 				return false;
 			}
 
-			return send(aSubscription, aCallback());
-		}
-
-		bool subscriptionActive(const string& aSubscription) const noexcept override {
 			// Enabled across all entities?
-			if (parentModule->subscriptionActive(aSubscription)) {
+			if (parentModule->subscriptionActive(parentSubscriptionIds[aId])) {
 				return true;
 			}
 
 			// Enabled for this entity only?
-			return SubscribableApiModule::subscriptionActive(aSubscription);
+			return SubscribableApiModule::subscriptionActive(aId);
 		}
 
 
@@ -260,6 +271,9 @@ namespace webserver {
 		ParentType* parentModule;
 
 		const IdJsonType jsonId;
+
+		// Indexed by our own subscription id
+		vector<SubscriptionId> parentSubscriptionIds;
 	};
 }
 
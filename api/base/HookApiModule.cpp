@@ -20,9 +20,26 @@
 
 #include <web-server/JsonUtil.h>
 #include <web-server/Session.h>
+#include <web-server/WebServerManager.h>
 
 #include <api/base/HookApiModule.h>
 
+#include <airdcpp/TimerManager.h>
+
+// Time to collect concurrent actions before sending a batch (when earlier actions are still pending)
+#define HOOK_BATCH_WINDOW_MS 10
+
+#define HOOK_BATCH_MAX_SIZE 100
+
+#define HOOK_CACHE_MAX_TTL 7 * 24 * 60 * 60 // seconds
+#define HOOK_CACHE_MAX_SIZE 500000 // results per hook
+
+// Subscriber is bypassed after this many consecutive timeouts or slow responses
+// (response taking more than half of the timeout)
+#define HOOK_BREAKER_FAILURE_THRESHOLD 3
+#define HOOK_BREAKER_OPEN_MS 30 * 1000
+#define HOOK_BREAKER_PROBE_TIMEOUT_MS 2 * 60 * 1000
+
 namespace webserver {
 	HookApiModule::HookApiModule(Session* aSession, Access aSubscriptionAccess, const StringList& aSubscriptions, Access aHookAccess) :
 		SubscribableApiModule(aSession, aSubscriptionAccess, aSubscriptions) 
@@ -31,6 +48,9 @@ namespace webserver {
 		METHOD_HANDLER(aHookAccess, METHOD_DELETE, (EXACT_PARAM("hooks"), STR_PARAM(LISTENER_PARAM_ID)), HookApiModule::handleRemoveHook);
 		METHOD_HANDLER(aHookAccess, METHOD_POST, (EXACT_PARAM("hooks"), STR_PARAM(LISTENER_PARAM_ID), TOKEN_PARAM, EXACT_PARAM("resolve")), HookApiModule::handleResolveHookAction);
 		METHOD_HANDLER(aHookAccess, METHOD_POST, (EXACT_PARAM("hooks"), STR_PARAM(LISTENER_PARAM_ID), TOKEN_PARAM, EXACT_PARAM("reject")), HookApiModule::handleRejectHookAction);
+		METHOD_HANDLER(aHookAccess, METHOD_POST, (EXACT_PARAM("hooks"), STR_PARAM(LISTENER_PARAM_ID), EXACT_PARAM("complete")), HookApiModule::handleCompleteHookActions);
+		METHOD_HANDLER(aHookAccess, METHOD_GET, (EXACT_PARAM("hooks"), STR_PARAM(LISTENER_PARAM_ID), EXACT_PARAM("cache")), HookApiModule::handleGetHookCacheStats);
+		METHOD_HANDLER(aHookAccess, METHOD_GET, (EXACT_PARAM("hooks")), HookApiModule::handleGetHooks);
 	}
 
 	void HookApiModule::on(SessionListener::SocketDisconnected) noexcept {
@@ -39,22 +59,22 @@ namespace webserver {
 		}
 
 		{
-			RLock l(cs);
-			for (auto& action : pendingHookActions | map_values) {
-				action.semaphore.signal();
-			}
+			Lock l(cacheCS);
+			resultCaches.clear();
 		}
 
-		// Wait for the pending action hooks to be cancelled
-		while (true) {
-			{
-				RLock l(cs);
-				if (pendingHookActions.empty()) {
-					break;
-				}
-			}
+		{
+			Lock l(batchCS);
+			pendingBatches.clear();
+		}
 
-			std::this_thread::sleep_for(chrono::milliseconds(100));
+		{
+			// Wake up the waiters, the actions are handled as timed out
+			WLock l(cs);
+			for (auto i = pendingHookActions.begin(); i != pendingHookActions.end();) {
+				i->second.semaphore->signal();
+				i = removePendingAction(i);
+			}
 		}
 
 		SubscribableApiModule::on(SessionListener::SocketDisconnected());
@@ -86,6 +106,8 @@ namespace webserver {
 		}
 
 		subscriberId = id;
+		batched = JsonUtil::getOptionalFieldDefault<bool>("batch", aJson, false);
+		cacheTtl = JsonUtil::getRangeFieldDefault<int>("cache_ttl", aJson, 0, 0, HOOK_CACHE_MAX_TTL);
 		active = true;
 		return true;
 	}
@@ -111,6 +133,10 @@ namespace webserver {
 			return websocketpp::http::status_code::conflict;
 		}
 
+		// Results of the previous subscriber may not be valid anymore
+		clearResultCache(aRequest.getStringParam(LISTENER_PARAM_ID));
+		hookStats.at(aRequest.getStringParam(LISTENER_PARAM_ID))->breaker.reset();
+
 		return websocketpp::http::status_code::no_content;
 	}
 
@@ -118,6 +144,8 @@ namespace webserver {
 		auto& hook = getHookSubscriber(aRequest);
 		hook.disable();
 
+		clearResultCache(aRequest.getStringParam(LISTENER_PARAM_ID));
+
 		return websocketpp::http::status_code::not_found;
 	}
 
@@ -132,6 +160,7 @@ namespace webserver {
 
 	void HookApiModule::createHook(const string& aSubscription, HookAddF&& aAddHandler, HookRemoveF&& aRemoveF) noexcept {
 		hooks.emplace(aSubscription, HookSubscriber(std::move(aAddHandler), std::move(aRemoveF)));
+		hookStats.emplace(aSubscription, make_unique<HookStats>(HOOK_BREAKER_FAILURE_THRESHOLD, HOOK_BREAKER_OPEN_MS, HOOK_BREAKER_PROBE_TIMEOUT_MS));
 	}
 
 	api_return HookApiModule::handleResolveHookAction(ApiRequest& aRequest) {
@@ -145,19 +174,107 @@ namespace webserver {
 	api_return HookApiModule::handleHookAction(ApiRequest& aRequest, bool aRejected) {
 		auto id = aRequest.getTokenParam();
 
-		WLock l(cs);
-		auto h = pendingHookActions.find(id);
-		if (h == pendingHookActions.end()) {
+		if (!completeHookAction(id, std::make_shared<HookCompletionData>(aRejected, aRequest.getRequestBody()))) {
 			aRequest.setResponseErrorStr("No pending hook with ID " + std::to_string(id) + " (did the hook time out?)");
 			return websocketpp::http::status_code::not_found;
 		}
 
-		auto& action = h->second;
-		action.completionData = std::make_shared<HookCompletionData>(aRejected, aRequest.getRequestBody());
-		action.semaphore.signal();
 		return websocketpp::http::status_code::no_content;
 	}
 
+	api_return HookApiModule::handleCompleteHookActions(ApiRequest& aRequest) {
+		const auto& resultsJson = JsonUtil::getArrayField("results", aRequest.getRequestBody(), false);
+
+		// Parse everything before completing the actions
+		vector<pair<int, HookCompletionDataPtr>> results;
+		for (const auto& resultJson: resultsJson) {
+			auto id = JsonUtil::getField<int>("completion_id", resultJson);
+			auto rejected = JsonUtil::getOptionalFieldDefault<bool>("rejected", resultJson, false);
+			results.emplace_back(id, std::make_shared<HookCompletionData>(rejected, JsonUtil::getOptionalRawField("data", resultJson, rejected)));
+		}
+
+		auto notFoundIds = json::array();
+		for (const auto& r: results) {
+			if (!completeHookAction(r.first, r.second)) {
+				notFoundIds.push_back(r.first);
+			}
+		}
+
+		if (notFoundIds.empty()) {
+			return websocketpp::http::status_code::no_content;
+		}
+
+		// Some of the actions have timed out
+		aRequest.setResponseBody({
+			{ "not_found_ids", notFoundIds },
+		});
+		return websocketpp::http::status_code::ok;
+	}
+
+	api_return HookApiModule::handleGetHookCacheStats(ApiRequest& aRequest) {
+		const auto& hook = getHookSubscriber(aRequest);
+
+		size_t cachedResults = 0;
+		uint64_t hits = 0, misses = 0;
+
+		{
+			Lock l(cacheCS);
+			auto i = resultCaches.find(aRequest.getStringParam(LISTENER_PARAM_ID));
+			if (i != resultCaches.end()) {
+				cachedResults = i->second.results.size();
+				hits = i->second.hits;
+				misses = i->second.misses;
+			}
+		}
+
+		aRequest.setResponseBody({
+			{ "ttl", hook.getCacheTtl() },
+			{ "results", cachedResults },
+			{ "hits", hits },
+			{ "misses", misses },
+		});
+		return websocketpp::http::status_code::ok;
+	}
+
+	api_return HookApiModule::handleGetHooks(ApiRequest& aRequest) {
+		auto ret = json::array();
+		for (const auto& h: hooks) {
+			const auto& stats = *hookStats.at(h.first);
+			ret.push_back({
+				{ "id", h.first },
+				{ "active", h.second.isActive() },
+				{ "subscriber_id", h.second.getSubscriberId() },
+				{ "batch", h.second.isBatched() },
+				{ "cache_ttl", h.second.getCacheTtl() },
+				{ "response_times", stats.responseTimes.toJson() },
+				{ "timeouts", stats.timeouts.load() },
+				{ "circuit_breaker", stats.breaker.toJson() },
+			});
+		}
+
+		aRequest.setResponseBody(ret);
+		return websocketpp::http::status_code::ok;
+	}
+
+	void HookApiModule::clearResultCache(const string& aSubscription) noexcept {
+		Lock l(cacheCS);
+		resultCaches.erase(aSubscription);
+	}
+
+	bool HookApiModule::completeHookAction(int aId, const HookCompletionDataPtr& aCompletionData) noexcept {
+		WLock l(cs);
+		auto h = pendingHookActions.find(aId);
+		if (h == pendingHookActions.end()) {
+			return false;
+		}
+
+		auto& action = h->second;
+		action.completionData = aCompletionData;
+		action.completed = std::chrono::steady_clock::now();
+		action.semaphore->signal();
+		return true;
+	}
+
 	int HookApiModule::getActionId() noexcept {
 		if (pendingHookIdCounter == std::numeric_limits<int>::max()) {
 			pendingHookIdCounter = 0;
@@ -166,54 +283,283 @@ namespace webserver {
 		return pendingHookIdCounter++;
 	}
 
+	int HookApiModule::addPendingAction(const string& aSubscription, int aTimeoutMs) noexcept {
+		auto stats = hookStats.at(aSubscription).get();
+
+		WLock l(cs);
+		auto id = getActionId();
+		pendingHookActions.emplace(id, PendingAction({ make_shared<Semaphore>(), nullptr, stats, aTimeoutMs, std::chrono::steady_clock::now(), {}, GET_TICK() }));
+		stats->pendingActions++;
+		//dcdebug("Adding action %d, total pending count %d\n", id, pendingHookActions.size());
+		return id;
+	}
+
 	HookApiModule::HookCompletionDataPtr HookApiModule::fireHook(const string& aSubscription, int aTimeoutSeconds, JsonCallback&& aJsonCallback) {
-		if (!hookActive(aSubscription)) {
+		if (!hookActive(aSubscription) || !hookStats.at(aSubscription)->breaker.allowCall()) {
 			return nullptr;
 		}
 
-#ifdef _DEBUG
-		auto start = std::chrono::system_clock::now();
-#endif
-
 		// Add a pending entry
-		decltype(pendingHookIdCounter) id;
-		Semaphore completionSemaphore;
+		auto id = addPendingAction(aSubscription, aTimeoutSeconds * 1000);
 
-		{
-			WLock l(cs);
-			id = getActionId();
-			pendingHookActions.emplace(id, PendingAction({ completionSemaphore, nullptr }));
-			//dcdebug("Adding action %d for hook %s, total pending count %d\n", id, aSubscription.c_str(), pendingHookActions.size());
+		// Notify the subscriber
+		auto sent = hooks.at(aSubscription).isBatched() ? 
+			sendHookActionBatch(aSubscription, id, aJsonCallback()) :
+			sendHookAction(aSubscription, id, aJsonCallback());
+
+		return waitHookAction(aSubscription, id, sent ? aTimeoutSeconds * 1000 : 0);
+	}
+
+	optional<int> HookApiModule::dispatchHook(const string& aSubscription, int aTimeoutMs, json&& aData) noexcept {
+		if (!hookActive(aSubscription) || !hookStats.at(aSubscription)->breaker.allowCall()) {
+			return nullopt;
 		}
 
-		// Notify the subscriber
-		if (send({
-			{ "event", aSubscription },
-			{ "completion_id", id },
-			{ "data", aJsonCallback() },
-		})) {
-			completionSemaphore.wait(aTimeoutSeconds * 1000);
+		auto id = addPendingAction(aSubscription, aTimeoutMs);
+
+		// Batched subscribers expect all actions in batch events
+		auto sent = hooks.at(aSubscription).isBatched() ?
+			sendHookActionBatch(aSubscription, { { id, std::move(aData) } }) :
+			sendHookAction(aSubscription, id, std::move(aData));
+
+		if (!sent) {
+			cancelHookAction(id);
+			return nullopt;
+		}
+
+		return id;
+	}
+
+	void HookApiModule::cancelHookAction(int aActionId) noexcept {
+		WLock l(cs);
+		auto i = pendingHookActions.find(aActionId);
+		if (i != pendingHookActions.end()) {
+			removePendingAction(i);
+		}
+	}
+
+	HookApiModule::PendingHookActionMap::iterator HookApiModule::removePendingAction(PendingHookActionMap::iterator aAction) noexcept {
+		aAction->second.stats->pendingActions--;
+		return pendingHookActions.erase(aAction);
+	}
+
+	HookApiModule::HookCompletionDataPtr HookApiModule::waitHookAction(const string& aSubscription, int aActionId, int aTimeoutMs) noexcept {
+		if (aTimeoutMs > 0) {
+			shared_ptr<Semaphore> completionSemaphore;
+
+			{
+				RLock l(cs);
+				auto i = pendingHookActions.find(aActionId);
+				if (i != pendingHookActions.end()) {
+					completionSemaphore = i->second.semaphore;
+				}
+			}
+
+			if (completionSemaphore) {
+				completionSemaphore->wait(aTimeoutMs);
+			}
 		}
 
 		// Clean up
-		HookCompletionDataPtr completionData = nullptr;
+		optional<PendingAction> action;
 
 		{
 			WLock l(cs);
-			completionData = pendingHookActions.at(id).completionData;
-			pendingHookActions.erase(id);
+			auto i = pendingHookActions.find(aActionId);
+			if (i == pendingHookActions.end()) {
+				// Cancelled (e.g. the socket was disconnected)
+				dcdebug("Action %s (id %d) was removed while waiting\n", aSubscription.c_str(), aActionId);
+				return nullptr;
+			}
+
+			action = i->second;
+			removePendingAction(i);
 		}
 
-		if (!completionData) {
+		onHookActionCompleted(aSubscription, *action);
+
+		if (!action->completionData) {
 			session->reportError("Action " + aSubscription + " timed out for subscriber " + session->getUser()->getUserName() + "\n");
-			dcdebug("Action %s (id %d) timed out\n", aSubscription.c_str(), id);
-#ifdef _DEBUG
+			dcdebug("Action %s (id %d) timed out\n", aSubscription.c_str(), aActionId);
 		} else {
-			std::chrono::duration<double> ellapsed = std::chrono::system_clock::now() - start;
-			dcdebug("Action %s (id %d) completed in %f s\n", aSubscription.c_str(), id, ellapsed.count());
-#endif
+			dcdebug("Action %s (id %d) completed in %f s\n", aSubscription.c_str(), aActionId, std::chrono::duration<double>(action->completed - action->started).count());
+		}
+
+		return action->completionData;
+	}
+
+	void HookApiModule::onHookActionCompleted(const string& aSubscription, const PendingAction& aAction) noexcept {
+		auto& stats = *aAction.stats;
+
+		auto slow = false;
+		if (aAction.completionData) {
+			// Measured when the response was received (the waiter may have woken up later)
+			auto duration = aAction.completed - aAction.started;
+			stats.responseTimes.add(duration);
+			slow = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() * 2 > aAction.timeoutMs;
+		} else {
+			stats.timeouts++;
+		}
+
+		if (stats.breaker.onResult(!aAction.completionData || slow, aAction.startTick)) {
+			session->reportError("Action " + aSubscription + " is bypassed for subscriber " + session->getUser()->getUserName() + " for " + 
+				Util::toString(HOOK_BREAKER_OPEN_MS / 1000) + " seconds because of slow responses\n");
+		}
+	}
+
+	HookApiModule::HookCompletionDataPtr HookApiModule::fireCachedHook(const string& aSubscription, const CacheKeyGetter& aCacheKeyGetter, int aTimeoutSeconds, JsonCallback&& aJsonCallback) {
+		if (!hookActive(aSubscription)) {
+			return nullptr;
+		}
+
+		auto ttl = hooks.at(aSubscription).getCacheTtl();
+		if (ttl == 0) {
+			return fireHook(aSubscription, aTimeoutSeconds, std::move(aJsonCallback));
+		}
+
+		const auto cacheKey = aCacheKeyGetter();
+
+		{
+			Lock l(cacheCS);
+			auto& cache = resultCaches[aSubscription];
+			auto i = cache.keyMap.find(cacheKey);
+			if (i != cache.keyMap.end()) {
+				auto result = i->second;
+				if (result->expires > GET_TICK()) {
+					cache.hits++;
+					cache.results.splice(cache.results.begin(), cache.results, result);
+					return result->completionData;
+				}
+
+				cache.keyMap.erase(i);
+				cache.results.erase(result);
+			}
+
+			cache.misses++;
+		}
+
+		auto completionData = fireHook(aSubscription, aTimeoutSeconds, std::move(aJsonCallback));
+		if (!completionData) {
+			// Timed out, ask again next time
+			return nullptr;
+		}
+
+		{
+			Lock l(cacheCS);
+			auto& cache = resultCaches[aSubscription];
+			const auto expires = GET_TICK() + static_cast<uint64_t>(ttl) * 1000;
+
+			auto i = cache.keyMap.find(cacheKey);
+			if (i != cache.keyMap.end()) {
+				// Added by a concurrent caller
+				auto result = i->second;
+				result->completionData = completionData;
+				result->expires = expires;
+				cache.results.splice(cache.results.begin(), cache.results, result);
+			} else {
+				if (cache.results.size() >= HOOK_CACHE_MAX_SIZE) {
+					cache.keyMap.erase(cache.results.back().key);
+					cache.results.pop_back();
+				}
+
+				cache.results.push_front({ cacheKey, completionData, expires });
+				cache.keyMap.emplace(cacheKey, cache.results.begin());
+			}
 		}
 
 		return completionData;
 	}
-}
\ No newline at end of file
+
+	bool HookApiModule::sendHookAction(const string& aSubscription, int aId, json&& aData) noexcept {
+		return send({
+			{ "event", aSubscription },
+			{ "completion_id", aId },
+			{ "data", std::move(aData) },
+		});
+	}
+
+	bool HookApiModule::sendHookActionBatch(const string& aSubscription, int aId, json&& aData) noexcept {
+		const auto& stats = *hookStats.at(aSubscription);
+
+		HookActionBatch readyBatch;
+		bool scheduleFlush = false;
+
+		{
+			Lock l(batchCS);
+			auto& batch = pendingBatches[aSubscription];
+
+			// The first action of the batch starts the collection window
+			auto first = batch.empty();
+
+			batch.emplace_back(aId, std::move(aData));
+
+			// There's nothing to wait for if this is the only action in flight
+			if (batch.size() >= HOOK_BATCH_MAX_SIZE || (first && stats.pendingActions <= 1)) {
+				readyBatch.swap(batch);
+			} else {
+				scheduleFlush = first;
+			}
+		}
+
+		if (!readyBatch.empty()) {
+			return sendHookActionBatch(aSubscription, std::move(readyBatch));
+		}
+
+		if (scheduleFlush) {
+			session->getServer()->addDelayedTask(getAsyncWrapper([this, aSubscription] {
+				flushHookActionBatch(aSubscription);
+			}), HOOK_BATCH_WINDOW_MS, WebServerManager::PRIORITY_INTERACTIVE);
+		}
+
+		return true;
+	}
+
+	void HookApiModule::flushHookActionBatch(const string& aSubscription) noexcept {
+		HookActionBatch batch;
+
+		{
+			Lock l(batchCS);
+			auto i = pendingBatches.find(aSubscription);
+			if (i == pendingBatches.end()) {
+				return;
+			}
+
+			batch.swap(i->second);
+		}
+
+		if (batch.empty()) {
+			// Filled up and sent by a caller
+			return;
+		}
+
+		sendHookActionBatch(aSubscription, std::move(batch));
+	}
+
+	bool HookApiModule::sendHookActionBatch(const string& aSubscription, HookActionBatch&& aBatch) noexcept {
+		auto actions = json::array();
+		for (auto& action: aBatch) {
+			actions.push_back({
+				{ "completion_id", action.first },
+				{ "data", std::move(action.second) },
+			});
+		}
+
+		if (send({
+			{ "event", aSubscription },
+			{ "batch", std::move(actions) },
+		})) {
+			return true;
+		}
+
+		// Don't let the callers wait until the timeout
+		RLock l(cs);
+		for (const auto& action: aBatch) {
+			auto h = pendingHookActions.find(action.first);
+			if (h != pendingHookActions.end()) {
+				h->second.semaphore->signal();
+			}
+		}
+
+		return false;
+	}
+}
@@ -20,6 +20,8 @@
 #define DCPLUSPLUS_DCPP_HOOK_APIMODULE_H
 
 #include <web-server/Access.h>
+#include <web-server/CircuitBreaker.h>
+#include <web-server/LatencyHistogram.h>
 #include <web-server/SessionListener.h>
 
 #include <airdcpp/ActionHook.h>
@@ -48,8 +50,20 @@ namespace webserver {
 			const string& getSubscriberId() const noexcept {
 				return subscriberId;
 			}
+
+			// Concurrent actions are sent to the subscriber in a single event
+			bool isBatched() const noexcept {
+				return batched;
+			}
+
+			// Seconds, 0 = results aren't cached
+			int getCacheTtl() const noexcept {
+				return cacheTtl;
+			}
 		private:
 			bool active = false;
+			bool batched = false;
+			int cacheTtl = 0;
 
 			const HookAddF addHandler;
 			const HookRemoveF removeHandler;
@@ -97,6 +111,18 @@ namespace webserver {
 		virtual bool hookActive(const string& aSubscription) const noexcept;
 
 		virtual HookCompletionDataPtr fireHook(const string& aSubscription, int aTimeoutSeconds, JsonCallback&& aJsonCallback);
+
+		// Returns a cached result if the subscriber has enabled result caching for the hook
+		// The cache key must identify all data that is sent to the subscriber
+		typedef std::function<string()> CacheKeyGetter;
+		virtual HookCompletionDataPtr fireCachedHook(const string& aSubscription, const CacheKeyGetter& aCacheKeyGetter, int aTimeoutSeconds, JsonCallback&& aJsonCallback);
+
+		// Sends the action to the subscriber without waiting for the result
+		// The returned action ID must be passed to waitHookAction or cancelHookAction
+		// The timeout is used for evaluating the response time of the subscriber
+		optional<int> dispatchHook(const string& aSubscription, int aTimeoutMs, json&& aData) noexcept;
+		HookCompletionDataPtr waitHookAction(const string& aSubscription, int aActionId, int aTimeoutMs) noexcept;
+		void cancelHookAction(int aActionId) noexcept;
 	protected:
 		HookSubscriber& getHookSubscriber(ApiRequest& aRequest);
 
@@ -106,24 +132,101 @@ namespace webserver {
 		virtual api_return handleRemoveHook(ApiRequest& aRequest);
 		virtual api_return handleResolveHookAction(ApiRequest& aRequest);
 		virtual api_return handleRejectHookAction(ApiRequest& aRequest);
+		virtual api_return handleCompleteHookActions(ApiRequest& aRequest);
+		virtual api_return handleGetHookCacheStats(ApiRequest& aRequest);
+		virtual api_return handleGetHooks(ApiRequest& aRequest);
 	private:
 		api_return handleHookAction(ApiRequest& aRequest, bool aRejected);
 
+		// Returns false if the action wasn't found
+		bool completeHookAction(int aId, const HookCompletionDataPtr& aCompletionData) noexcept;
+
+		// Returns false if the subscriber couldn't be notified
+		bool sendHookAction(const string& aSubscription, int aId, json&& aData) noexcept;
+
+		// Actions are collected for a short while only if the subscriber is already busy with earlier actions
+		// The collected batch is sent by a delayed task so that the callers don't have to wait for the window
+		// Returns false if the action couldn't be sent immediately (the waiters are signaled if a delayed send fails)
+		typedef vector<pair<int, json>> HookActionBatch;
+		bool sendHookActionBatch(const string& aSubscription, int aId, json&& aData) noexcept;
+		bool sendHookActionBatch(const string& aSubscription, HookActionBatch&& aBatch) noexcept;
+		void flushHookActionBatch(const string& aSubscription) noexcept;
+
+		struct CachedResult {
+			string key;
+			HookCompletionDataPtr completionData;
+			uint64_t expires;
+		};
+
+		// The least recently used result is evicted when the cache is full
+		struct HookResultCache {
+			typedef list<CachedResult> ResultList;
+
+			// Most recently used first
+			ResultList results;
+			unordered_map<string, ResultList::iterator> keyMap;
+
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+		};
+
+		// Cached results by hook
+		map<string, HookResultCache> resultCaches;
+		CriticalSection cacheCS;
+
+		void clearResultCache(const string& aSubscription) noexcept;
+
+		// Batches that are waiting to be sent, by hook
+		map<string, HookActionBatch> pendingBatches;
+		CriticalSection batchCS;
+
+		// Response times of the subscriber
+		struct HookStats {
+			HookStats(int aFailureThreshold, uint64_t aOpenTime, uint64_t aProbeTimeout) : breaker(aFailureThreshold, aOpenTime, aProbeTimeout) { }
+
+			LatencyHistogram responseTimes;
+			atomic<uint64_t> timeouts { 0 };
+
+			// Actions waiting for a response from the subscriber
+			atomic<int> pendingActions { 0 };
+
+			// Stops calling the subscriber temporarily after repeated timeouts/slow responses
+			CircuitBreaker breaker;
+		};
+
 		struct PendingAction {
-			Semaphore& semaphore;
+			shared_ptr<Semaphore> semaphore;
 			HookCompletionDataPtr completionData;
+			HookStats* stats;
+
+			// Full timeout of the action (the caller may wait only for a part of it)
+			int timeoutMs;
+
+			std::chrono::steady_clock::time_point started;
+			std::chrono::steady_clock::time_point completed;
+
+			// GET_TICK, for the circuit breaker
+			uint64_t startTick;
 		};
 
+		// Created for each hook on creation
+		map<string, unique_ptr<HookStats>> hookStats;
+		void onHookActionCompleted(const string& aSubscription, const PendingAction& aAction) noexcept;
+
 		typedef map<int, PendingAction> PendingHookActionMap;
 
 		PendingHookActionMap pendingHookActions;
 
+		// The write lock must be held
+		PendingHookActionMap::iterator removePendingAction(PendingHookActionMap::iterator aAction) noexcept;
+
 		map<string, HookSubscriber> hooks;
 
 		int pendingHookIdCounter = 1;
 		mutable SharedMutex cs;
 
 		int getActionId() noexcept;
+		int addPendingAction(const string& aSubscription, int aTimeoutMs) noexcept;
 	};
 
 	typedef std::unique_ptr<ApiModule> HandlerPtr;
@@ -34,7 +34,11 @@ namespace webserver {
 	public:
 		typedef typename std::function<const T&()> ChatGetterF;
 		ChatController(SubscribableApiModule* aModule, const ChatGetterF& aChatF, const string& aSubscriptionId, Access aViewPermission, Access aEditPermission, Access aSendPermission) :
-			module(aModule), subscriptionId(aSubscriptionId), chatF(aChatF)
+			module(aModule), subscriptionId(aSubscriptionId), chatF(aChatF),
+			messageSubscription(aModule->getSubscriptionId(toListenerName("message"))),
+			statusSubscription(aModule->getSubscriptionId(toListenerName("status"))),
+			textCommandSubscription(aModule->getSubscriptionId(toListenerName("text_command"))),
+			updatedSubscription(aModule->getSubscriptionId(toListenerName("updated")))
 		{
 			MODULE_METHOD_HANDLER(aModule, aSendPermission, METHOD_POST, (EXACT_PARAM("chat_message")), ChatController::handlePostChatMessage);
 			MODULE_METHOD_HANDLER(aModule, aEditPermission, METHOD_POST, (EXACT_PARAM("status_message")), ChatController::handlePostStatusMessage);
@@ -49,23 +53,21 @@ namespace webserver {
 		void onChatMessage(const ChatMessagePtr& aMessage) noexcept {
 			onMessagesUpdated();
 
-			auto s = toListenerName("message");
-			if (!module->subscriptionActive(s)) {
+			if (!module->subscriptionActive(messageSubscription)) {
 				return;
 			}
 
-			module->send(s, MessageUtils::serializeChatMessage(aMessage));
+			module->send(module->getSubscriptionName(messageSubscription), MessageUtils::serializeChatMessage(aMessage));
 		}
 
 		void onStatusMessage(const LogMessagePtr& aMessage) noexcept {
 			onMessagesUpdated();
 
-			auto s = toListenerName("status");
-			if (!module->subscriptionActive(s)) {
+			if (!module->subscriptionActive(statusSubscription)) {
 				return;
 			}
 
-			module->send(s, MessageUtils::serializeLogMessage(aMessage));
+			module->send(module->getSubscriptionName(statusSubscription), MessageUtils::serializeLogMessage(aMessage));
 		}
 
 		void onMessagesUpdated() {
@@ -73,8 +75,7 @@ namespace webserver {
 		}
 
 		void onChatCommand(const OutgoingChatMessage& aMessage) {
-			auto s = toListenerName("text_command");
-			if (!module->subscriptionActive(s)) {
+			if (!module->subscriptionActive(textCommandSubscription)) {
 				return;
 			}
 
@@ -90,7 +91,7 @@ namespace webserver {
 
 			tokens.pop_front();
 
-			module->send(s, {
+			module->send(module->getSubscriptionName(textCommandSubscription), {
 				{ "command", command.substr(1) },
 				{ "args", tokens },
 				{ "permissions",  Serializer::serializePermissions(parseMessageAuthorAccess(aMessage)) },
@@ -98,12 +99,11 @@ namespace webserver {
 		}
 	private:
 		void sendUnread() noexcept {
-			auto s = toListenerName("updated");
-			if (!module->subscriptionActive(s)) {
+			if (!module->subscriptionActive(updatedSubscription)) {
 				return;
 			}
 
-			module->send(s, {
+			module->send(module->getSubscriptionName(updatedSubscription), {
 				{ "message_counts",  MessageUtils::serializeCacheInfo(chatF()->getCache(), MessageUtils::serializeUnreadChat) },
 			});
 		}
@@ -186,6 +186,12 @@ namespace webserver {
 		ChatGetterF chatF;
 		string subscriptionId;
 		SubscribableApiModule* module;
+
+		// Resolved once as the chat events are fired frequently
+		const SubscriptionId messageSubscription;
+		const SubscriptionId statusSubscription;
+		const SubscriptionId textCommandSubscription;
+		const SubscriptionId updatedSubscription;
 	};
 }
 
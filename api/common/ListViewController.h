@@ -61,6 +61,7 @@ namespace webserver {
 
 		~ListViewController() {
 			module->getSession()->removeListener(this);
+			setActive(false);
 
 			timer->stop(true);
 		}
@@ -126,7 +127,12 @@ namespace webserver {
 		}
 	private:
 		void setActive(bool aActive) {
+			if (active == aActive) {
+				return;
+			}
+
 			active = aActive;
+			module->getSession()->getServer()->getApiMetrics().onViewStateChanged(aActive);
 		}
 
 		// FILTERS START
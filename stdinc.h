@@ -95,6 +95,9 @@ namespace webserver {
 	typedef std::vector<SessionPtr> SessionList;
 	typedef uint32_t LocalSessionId;
 
+	// Index of a subscription within its API module (see SubscribableApiModule)
+	typedef int SubscriptionId;
+
 	typedef map<string, json> SettingValueMap;
 
 	class Timer;
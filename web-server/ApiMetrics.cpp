@@ -0,0 +1,209 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/ApiMetrics.h>
+#include <web-server/WebServerManager.h>
+#include <web-server/WebSocket.h>
+
+namespace webserver {
+	ApiMetrics::ApiMetrics(WebServerManager* aWsm) : wsm(aWsm) {
+		routePaths.push_back("(unmatched)");
+	}
+
+	int ApiMetrics::getRouteId(int aParentRouteId, const string& aModule, const string& aHandlerPattern) noexcept {
+		WLock l(cs);
+		auto path = (aParentRouteId < 0 ? aModule : routePaths[aParentRouteId]) + "/" + aHandlerPattern;
+
+		auto i = routeIds.find(path);
+		if (i != routeIds.end()) {
+			return i->second;
+		}
+
+		auto id = static_cast<int>(routePaths.size());
+		routePaths.push_back(path);
+		routeIds.emplace(std::move(path), id);
+		return id;
+	}
+
+	ApiMetrics::RouteStats& ApiMetrics::getRouteStats(int aRouteId, RequestMethod aMethod) noexcept {
+		const auto index = static_cast<size_t>(aRouteId) * METHOD_SLOTS + min(static_cast<size_t>(aMethod), METHOD_SLOTS - 1);
+
+		{
+			RLock l(cs);
+			if (index < routeStats.size() && routeStats[index]) {
+				return *routeStats[index];
+			}
+		}
+
+		WLock l(cs);
+		if (index >= routeStats.size()) {
+			routeStats.resize(routePaths.size() * METHOD_SLOTS);
+		}
+
+		auto& stats = routeStats[index];
+		if (!stats) {
+			stats = make_unique<RouteStats>();
+		}
+
+		return *stats;
+	}
+
+	string ApiMetrics::getRouteName(size_t aStatsIndex) const noexcept {
+		static const char* methodNames[METHOD_SLOTS] = { "POST", "GET", "PUT", "DELETE", "PATCH", "FORWARD", "OTHER" };
+		return string(methodNames[aStatsIndex % METHOD_SLOTS]) + " " + routePaths[aStatsIndex / METHOD_SLOTS];
+	}
+
+	void ApiMetrics::onRequestCompleted(int aRouteId, RequestMethod aMethod, int aStatusCode, 
+		std::chrono::steady_clock::duration aQueueTime, std::chrono::steady_clock::duration aHandlerTime) noexcept 
+	{
+		auto& stats = getRouteStats(aRouteId < 0 ? ROUTE_UNMATCHED : aRouteId, aMethod);
+		stats.queueTime.add(aQueueTime);
+		stats.handlerTime.add(aHandlerTime);
+
+		if (aStatusCode >= 500) {
+			stats.status5xx++;
+		} else if (aStatusCode >= 400) {
+			stats.status4xx++;
+		} else if (aStatusCode >= 300) {
+			stats.status3xx++;
+		} else {
+			stats.status2xx++;
+		}
+	}
+
+	json ApiMetrics::toJson() const noexcept {
+		json routesJson = json::object();
+
+		{
+			RLock l(cs);
+			for (size_t i = 0; i < routeStats.size(); i++) {
+				const auto& r = routeStats[i];
+				if (!r) {
+					continue;
+				}
+
+				routesJson[getRouteName(i)] = {
+					{ "status_2xx", r->status2xx.load() },
+					{ "status_3xx", r->status3xx.load() },
+					{ "status_4xx", r->status4xx.load() },
+					{ "status_5xx", r->status5xx.load() },
+					{ "queue_time", r->queueTime.toJson() },
+					{ "handler_time", r->handlerTime.toJson() },
+				};
+			}
+		}
+
+		json socketsJson = json::array();
+		for (const auto& s: wsm->getSockets()) {
+			socketsJson.push_back({
+				{ "session_id", s->getSession() ? json(s->getSession()->getId()) : json() },
+				{ "ip", s->getIp() },
+				{ "send_buffer_bytes", s->getBufferedAmount() },
+			});
+		}
+
+		return {
+			{ "routes", routesJson },
+			{ "task_queues", wsm->getTaskQueueStats() },
+			{ "task_pools", wsm->getTaskPoolStats() },
+			{ "event_queue", wsm->getEventBus().getQueueStats() },
+			{ "timer_lag", timerLag.toJson() },
+			{ "timer_wheel", wsm->getTimerWheel().toJson() },
+			{ "active_views", activeViews.load() },
+			{ "sockets", socketsJson },
+		};
+	}
+
+	string ApiMetrics::toPrometheus() const noexcept {
+		string ret;
+
+		{
+			ret += "# TYPE airdcpp_api_requests_total counter\n";
+			RLock l(cs);
+			for (size_t i = 0; i < routeStats.size(); i++) {
+				const auto& r = routeStats[i];
+				if (!r) {
+					continue;
+				}
+
+				const auto labels = "route=\"" + getRouteName(i) + "\"";
+				ret += "airdcpp_api_requests_total{" + labels + ",status=\"2xx\"} " + Util::toString(r->status2xx.load()) + "\n";
+				ret += "airdcpp_api_requests_total{" + labels + ",status=\"3xx\"} " + Util::toString(r->status3xx.load()) + "\n";
+				ret += "airdcpp_api_requests_total{" + labels + ",status=\"4xx\"} " + Util::toString(r->status4xx.load()) + "\n";
+				ret += "airdcpp_api_requests_total{" + labels + ",status=\"5xx\"} " + Util::toString(r->status5xx.load()) + "\n";
+			}
+
+			ret += "# TYPE airdcpp_api_request_queue_seconds histogram\n";
+			for (size_t i = 0; i < routeStats.size(); i++) {
+				if (routeStats[i]) {
+					routeStats[i]->queueTime.appendPrometheus(ret, "airdcpp_api_request_queue_seconds", "route=\"" + getRouteName(i) + "\"");
+				}
+			}
+
+			ret += "# TYPE airdcpp_api_request_duration_seconds histogram\n";
+			for (size_t i = 0; i < routeStats.size(); i++) {
+				if (routeStats[i]) {
+					routeStats[i]->handlerTime.appendPrometheus(ret, "airdcpp_api_request_duration_seconds", "route=\"" + getRouteName(i) + "\"");
+				}
+			}
+		}
+
+		{
+			const auto& interactive = wsm->getTaskQueueStats(WebServerManager::PRIORITY_INTERACTIVE);
+			const auto& background = wsm->getTaskQueueStats(WebServerManager::PRIORITY_BACKGROUND);
+
+			ret += "# TYPE airdcpp_task_queue_size gauge\n";
+			ret += "airdcpp_task_queue_size{priority=\"interactive\"} " + Util::toString(interactive.getQueueSize()) + "\n";
+			ret += "airdcpp_task_queue_size{priority=\"background\"} " + Util::toString(background.getQueueSize()) + "\n";
+
+			ret += "# TYPE airdcpp_task_queue_wait_seconds histogram\n";
+			interactive.getWaitTimes().appendPrometheus(ret, "airdcpp_task_queue_wait_seconds", "priority=\"interactive\"");
+			background.getWaitTimes().appendPrometheus(ret, "airdcpp_task_queue_wait_seconds", "priority=\"background\"");
+
+			ret += "# TYPE airdcpp_task_pool_threads gauge\n";
+			ret += "airdcpp_task_pool_threads{priority=\"interactive\"} " + Util::toString(wsm->getTaskPool(WebServerManager::PRIORITY_INTERACTIVE).getThreadCount()) + "\n";
+			ret += "airdcpp_task_pool_threads{priority=\"background\"} " + Util::toString(wsm->getTaskPool(WebServerManager::PRIORITY_BACKGROUND).getThreadCount()) + "\n";
+		}
+
+		ret += "# TYPE airdcpp_timer_lag_seconds histogram\n";
+		timerLag.appendPrometheus(ret, "airdcpp_timer_lag_seconds", Util::emptyString);
+
+		ret += "# TYPE airdcpp_active_views gauge\n";
+		ret += "airdcpp_active_views " + Util::toString(activeViews.load()) + "\n";
+
+		{
+			size_t socketCount = 0, bufferedTotal = 0, bufferedMax = 0;
+			for (const auto& s: wsm->getSockets()) {
+				auto buffered = s->getBufferedAmount();
+				socketCount++;
+				bufferedTotal += buffered;
+				bufferedMax = max(bufferedMax, buffered);
+			}
+
+			ret += "# TYPE airdcpp_sockets gauge\n";
+			ret += "airdcpp_sockets " + Util::toString(socketCount) + "\n";
+			ret += "# TYPE airdcpp_socket_send_buffer_bytes gauge\n";
+			ret += "airdcpp_socket_send_buffer_bytes{type=\"total\"} " + Util::toString(bufferedTotal) + "\n";
+			ret += "airdcpp_socket_send_buffer_bytes{type=\"max\"} " + Util::toString(bufferedMax) + "\n";
+		}
+
+		return ret;
+	}
+}
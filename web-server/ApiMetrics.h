@@ -0,0 +1,100 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_APIMETRICS_H
+#define DCPLUSPLUS_DCPP_APIMETRICS_H
+
+#include "stdinc.h"
+
+#include <web-server/ApiRequest.h>
+#include <web-server/LatencyHistogram.h>
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	class WebServerManager;
+
+	// Runtime metrics of the web server (request latencies, queues and timers)
+	class ApiMetrics {
+	public:
+		// Requests that didn't match any handler
+		static constexpr int ROUTE_UNMATCHED = 0;
+
+		ApiMetrics(WebServerManager* aWsm);
+
+		// Returns a stable id for the route of a request handler so that the handler path doesn't need to be formatted for each request
+		// aParentRouteId is the route of the forwarding handler (or -1 for handlers of the session modules)
+		int getRouteId(int aParentRouteId, const string& aModule, const string& aHandlerPattern) noexcept;
+
+		// aRouteId is the matched handler (or -1 if no handler matched)
+		void onRequestCompleted(int aRouteId, RequestMethod aMethod, int aStatusCode, 
+			std::chrono::steady_clock::duration aQueueTime, std::chrono::steady_clock::duration aHandlerTime) noexcept;
+
+		void onViewStateChanged(bool aActive) noexcept {
+			if (aActive) {
+				activeViews++;
+			} else {
+				activeViews--;
+			}
+		}
+
+		LatencyHistogram& getTimerLag() noexcept {
+			return timerLag;
+		}
+
+		json toJson() const noexcept;
+
+		// Prometheus text exposition format
+		string toPrometheus() const noexcept;
+
+		ApiMetrics(ApiMetrics&) = delete;
+		ApiMetrics& operator=(ApiMetrics&) = delete;
+	private:
+		struct RouteStats {
+			atomic<uint64_t> status2xx { 0 };
+			atomic<uint64_t> status3xx { 0 };
+			atomic<uint64_t> status4xx { 0 };
+			atomic<uint64_t> status5xx { 0 };
+
+			// Time spent in the task queues before the request was handled
+			LatencyHistogram queueTime;
+			LatencyHistogram handlerTime;
+		};
+
+		// Unknown methods are counted in the last slot
+		static constexpr size_t METHOD_SLOTS = METHOD_LAST + 1;
+
+		RouteStats& getRouteStats(int aRouteId, RequestMethod aMethod) noexcept;
+		string getRouteName(size_t aStatsIndex) const noexcept;
+
+		// Handler paths by route ID
+		StringList routePaths;
+		map<string, int> routeIds;
+
+		// Indexed by route ID * METHOD_SLOTS + method (created lazily)
+		vector<unique_ptr<RouteStats>> routeStats;
+		mutable SharedMutex cs;
+
+		LatencyHistogram timerLag;
+		atomic<int> activeViews { 0 };
+
+		WebServerManager* wsm;
+	};
+}
+
+#endif
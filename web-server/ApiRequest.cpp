@@ -23,10 +23,38 @@
 #include <airdcpp/CID.h>
 #include <airdcpp/MerkleTree.h>
 
-#include <airdcpp/StringTokenizer.h>
+#include <airdcpp/Encoder.h>
 #include <airdcpp/Util.h>
 
+#include <charconv>
+
 namespace webserver {
+	// Lenient conversion similar to Util::toInt (invalid values will result in 0)
+	template<typename T>
+	static T parseNumber(string_view aStr) noexcept {
+		T ret = 0;
+		std::from_chars(aStr.data(), aStr.data() + aStr.size(), ret);
+		return ret;
+	}
+
+	// Decodes a Base32 value into a fixed-size buffer without allocating
+	static bool decodeBase32(string_view aStr, uint8_t* dst_, size_t aLen) noexcept {
+		// Encoder requires a null-terminated string
+		char buf[64];
+		if (aStr.empty() || aStr.size() >= sizeof(buf)) {
+			return false;
+		}
+
+		memcpy(buf, aStr.data(), aStr.size());
+		buf[aStr.size()] = 0;
+		if (!Encoder::isBase32(buf)) {
+			return false;
+		}
+
+		Encoder::fromBase32(buf, dst_, aLen);
+		return true;
+	}
+
 	ApiRequest::ApiRequest(const string& aUrl, const string& aMethod, json&& aBody, const SessionPtr& aSession, const ApiDeferredHandler& aDeferredHandler, json& output_, json& error_) :
 		methodStr(aMethod), session(aSession), requestJson(std::move(aBody)), path(aUrl), deferredHandler(aDeferredHandler), responseJsonData(output_), responseJsonError(error_)
 	{
@@ -35,7 +63,8 @@ namespace webserver {
 			throw std::invalid_argument("Invalid URL path (the path should start with /api/v" + Util::toString(API_VERSION) + "/)");
 		}
 
-		pathTokens = StringTokenizer<std::string, deque>(aUrl.substr(4), '/').getTokens();
+		// Tokenize the stored path so that the views remain valid for the lifetime of the request
+		tokenizePath(string_view(path).substr(4), pathTokens);
 
 		if (aMethod == "GET") {
 			method = METHOD_GET;
@@ -52,6 +81,23 @@ namespace webserver {
 		validate();
 	}
 
+	void ApiRequest::tokenizePath(string_view aPath, PathTokenList& tokens_) noexcept {
+		size_t start = 0;
+		while (start < aPath.size()) {
+			auto end = aPath.find('/', start);
+			if (end == string_view::npos) {
+				end = aPath.size();
+			}
+
+			// Skip empty tokens
+			if (end != start) {
+				tokens_.push_back(aPath.substr(start, end - start));
+			}
+
+			start = end + 1;
+		}
+	}
+
 	void ApiRequest::validate() {
 		// Method
 		if (method == METHOD_LAST) {
@@ -65,20 +111,20 @@ namespace webserver {
 
 		// Version
 		auto version = pathTokens.front();
-		pathTokens.pop_front();
+		pathTokens.erase(pathTokens.begin());
 
 		// API Module
-		apiModule = pathTokens.front();
-		pathTokens.pop_front();
+		apiModule = string(pathTokens.front());
+		pathTokens.erase(pathTokens.begin());
 
 		if (version.size() < 2) {
 			throw std::invalid_argument("Invalid API version format");
 		}
 
-		apiVersion = Util::toInt(version.substr(1));
+		apiVersion = parseNumber<int>(version.substr(1));
 	}
 
-	void ApiRequest::setNamedParams(const NamedParamMap& aParams) noexcept {
+	void ApiRequest::setNamedParams(const NamedParamList& aParams) noexcept {
 		namedParameters = aParams;
 	}
 
@@ -86,42 +132,47 @@ namespace webserver {
 		pathTokens.erase(pathTokens.begin(), pathTokens.begin() + aCount);
 	}
 
-	uint32_t ApiRequest::getTokenParam(const string& aName) const noexcept {
-		return Util::toUInt32(namedParameters.at(aName));
+	string_view ApiRequest::getParam(string_view aName) const noexcept {
+		auto i = find_if(namedParameters.begin(), namedParameters.end(), [&](const NamedParamList::value_type& aParam) {
+			return aParam.first == aName;
+		});
+
+		dcassert(i != namedParameters.end());
+		return i != namedParameters.end() ? i->second : string_view();
 	}
 
-	const string& ApiRequest::getStringParam(const string& aName) const noexcept {
-		return namedParameters.at(aName);
+	uint32_t ApiRequest::getTokenParam(string_view aName) const noexcept {
+		return parseNumber<uint32_t>(getParam(aName));
 	}
 
-	int ApiRequest::getRangeParam(const string& aName) const noexcept {
-		return Util::toInt(namedParameters.at(aName));
+	int ApiRequest::getRangeParam(string_view aName) const noexcept {
+		return parseNumber<int>(getParam(aName));
 	}
 
-	int64_t ApiRequest::getSizeParam(const string& aName) const noexcept {
-		return Util::toInt64(namedParameters.at(aName));
+	int64_t ApiRequest::getSizeParam(string_view aName) const noexcept {
+		return parseNumber<int64_t>(getParam(aName));
 	}
 
-	const std::string& ApiRequest::getPathTokenAt(int aIndex) const noexcept {
+	string_view ApiRequest::getPathTokenAt(int aIndex) const noexcept {
 		return pathTokens[aIndex];
 	}
 
-	TTHValue ApiRequest::getTTHParam(const string& aName) const {
-		auto param = getStringParam(aName);
-		if (!Encoder::isBase32(param.c_str())) {
+	TTHValue ApiRequest::getTTHParam(string_view aName) const {
+		TTHValue ret;
+		if (!decodeBase32(getParam(aName), ret.data, sizeof(ret.data))) {
 			throw std::invalid_argument("Invalid TTH URL parameter");
 		}
 
-		return TTHValue(param);
+		return ret;
 	}
 
-	CID ApiRequest::getCIDParam(const string& aName) const {
-		auto param = getStringParam(aName);
-		if (!Encoder::isBase32(param.c_str())) {
+	CID ApiRequest::getCIDParam(string_view aName) const {
+		uint8_t data[CID::SIZE];
+		if (!decodeBase32(getParam(aName), data, sizeof(data))) {
 			throw std::invalid_argument("Invalid CID URL parameter");
 		}
 
-		return CID(param);
+		return CID(data);
 	}
 
 
@@ -24,6 +24,8 @@
 #include <airdcpp/typedefs.h>
 #include <airdcpp/GetSet.h>
 
+#include <boost/container/small_vector.hpp>
+
 #define TOKEN_PARAM_ID "id_param"
 #define TTH_PARAM_ID "tth_param"
 #define CID_PARAM_ID "cid_param"
@@ -41,12 +43,19 @@ namespace webserver {
 
 	class ApiRequest {
 	public:
-		typedef std::deque<std::string> PathTokenList;
-		typedef std::map<std::string, std::string> NamedParamMap;
+		// Path tokens and parameter values are views to the request path and the parameter names are views to the 
+		// names of the matched handler (the handler must outlive the request)
+		// Typical requests fit in the inline storage so that parsing and matching them won't allocate
+		typedef boost::container::small_vector<std::string_view, 8> PathTokenList;
+		typedef boost::container::small_vector<std::pair<std::string_view, std::string_view>, 4> NamedParamList;
 
 		// Throws on errors
 		ApiRequest(const std::string& aUrl, const std::string& aMethod, json&& aBody, const SessionPtr& aSession, const ApiDeferredHandler& aDeferredHandler, json& output_, json& error_);
 
+		// Tokens are views to the path that is owned by the request
+		ApiRequest(ApiRequest&) = delete;
+		ApiRequest& operator=(ApiRequest&) = delete;
+
 		int getApiVersion() const noexcept {
 			return apiVersion;
 		}
@@ -69,19 +78,25 @@ namespace webserver {
 
 		void popParam(size_t aCount = 1) noexcept;
 
-		const std::string& getStringParam(const string& aName) const noexcept;
-		const std::string& getPathTokenAt(int aIndex) const noexcept;
+		// Zero-copy access to a named parameter
+		std::string_view getParam(std::string_view aName) const noexcept;
+
+		std::string getStringParam(std::string_view aName) const noexcept {
+			return std::string(getParam(aName));
+		}
+
+		std::string_view getPathTokenAt(int aIndex) const noexcept;
 
 		// Throws in case of errors
-		TTHValue getTTHParam(const string& aName = TTH_PARAM_ID) const;
+		TTHValue getTTHParam(std::string_view aName = TTH_PARAM_ID) const;
 
 		// Throws in case of errors
-		CID getCIDParam(const string& aName = CID_PARAM_ID) const;
+		CID getCIDParam(std::string_view aName = CID_PARAM_ID) const;
 
 		// Use different naming to avoid accidentally using wrong conversion...
-		uint32_t getTokenParam(const string& aName = TOKEN_PARAM_ID) const noexcept;
-		int getRangeParam(const string& aName) const noexcept;
-		int64_t getSizeParam(const string& aName) const noexcept;
+		uint32_t getTokenParam(std::string_view aName = TOKEN_PARAM_ID) const noexcept;
+		int getRangeParam(std::string_view aName) const noexcept;
+		int64_t getSizeParam(std::string_view aName) const noexcept;
 
 		bool hasRequestBody() const noexcept {
 			return !requestJson.is_null();
@@ -117,19 +132,32 @@ namespace webserver {
 			return path;
 		}
 
-		void setNamedParams(const NamedParamMap& aParams) noexcept;
+		void setNamedParams(const NamedParamList& aParams) noexcept;
+
+		// Interned path of the last matched handler without parameter values (see ApiMetrics::getRouteId)
+		// -1 if no handler has been matched
+		int getRouteId() const noexcept {
+			return routeId;
+		}
+
+		void setRouteId(int aRouteId) noexcept {
+			routeId = aRouteId;
+		}
 
 		ApiCompletionF defer();
 	private:
 		SessionPtr session;
 		void validate();
 
+		static void tokenizePath(std::string_view aPath, PathTokenList& tokens_) noexcept;
+
 		const string path;
 		const string methodStr;
 		PathTokenList pathTokens;
-		NamedParamMap namedParameters;
+		NamedParamList namedParameters;
 		int apiVersion = -1;
 		std::string apiModule;
+		int routeId = -1;
 
 		RequestMethod method = METHOD_LAST;
 
@@ -42,7 +42,7 @@ namespace webserver {
 
 	}
 
-	void ApiRouter::handleSocketRequest(const string& aMessage, const WebSocketPtr& aSocket, bool aIsSecure) noexcept {
+	void ApiRouter::handleSocketRequest(const string& aMessage, const WebSocketPtr& aSocket, bool aIsSecure, TimePoint aQueuedAt) noexcept {
 
 		dcdebug("Received socket request: %s\n", aMessage.size() > 500 ? (aMessage.substr(0, 500) + "...").c_str() : aMessage.c_str());
 
@@ -76,7 +76,7 @@ namespace webserver {
 
 		json responseJsonData, responseErrorJson;
 		ApiRequest apiRequest(aSocket->getConnectUrl() + path, method, std::move(data), aSocket->getSession(), deferredF, responseJsonData, responseErrorJson);
-		code = handleRequest(apiRequest, aIsSecure, aSocket, aSocket->getIp());
+		code = handleRequest(apiRequest, aIsSecure, aSocket, aSocket->getIp(), aQueuedAt);
 		if (!isDeferred) {
 			responseF(code, responseJsonData, responseErrorJson);
 		}
@@ -84,7 +84,7 @@ namespace webserver {
 
 	websocketpp::http::status_code::value ApiRouter::handleHttpRequest(const string& aRequestPath,
 		const websocketpp::http::parser::request& aRequest, json& output_, json& error_,
-		bool aIsSecure, const string& aIp, const SessionPtr& aSession, const ApiDeferredHandler& aDeferredHandler) noexcept 
+		bool aIsSecure, const string& aIp, const SessionPtr& aSession, const ApiDeferredHandler& aDeferredHandler, TimePoint aQueuedAt) noexcept 
 	{
 
 		dcdebug("Received HTTP request: %s\n", aRequest.get_body().c_str());
@@ -92,7 +92,7 @@ namespace webserver {
 			auto bodyJson = aRequest.get_body().empty() ? json() : json::parse(aRequest.get_body());
 
 			ApiRequest apiRequest(aRequestPath, aRequest.get_method(), std::move(bodyJson), aSession, aDeferredHandler, output_, error_);
-			const auto status = handleRequest(apiRequest, aIsSecure, nullptr, aIp);
+			const auto status = handleRequest(apiRequest, aIsSecure, nullptr, aIp, aQueuedAt);
 			return status;
 		} catch (const std::exception& e) {
 			error_ = { 
@@ -103,7 +103,23 @@ namespace webserver {
 		return websocketpp::http::status_code::bad_request;
 	}
 
-	api_return ApiRouter::handleRequest(ApiRequest& aRequest, bool aIsSecure, const WebSocketPtr& aSocket, const string& aIp) noexcept {
+	api_return ApiRouter::handleRequest(ApiRequest& aRequest, bool aIsSecure, const WebSocketPtr& aSocket, const string& aIp, TimePoint aQueuedAt) noexcept {
+		auto start = std::chrono::steady_clock::now();
+		auto code = routeRequest(aRequest, aIsSecure, aSocket, aIp);
+
+		// Use the handler path to keep the number of different routes bounded
+		WebServerManager::getInstance()->getApiMetrics().onRequestCompleted(
+			aRequest.getRouteId(),
+			aRequest.getMethod(),
+			code, 
+			start - aQueuedAt,
+			std::chrono::steady_clock::now() - start
+		);
+
+		return code;
+	}
+
+	api_return ApiRouter::routeRequest(ApiRequest& aRequest, bool aIsSecure, const WebSocketPtr& aSocket, const string& aIp) noexcept {
 		if (aRequest.getApiVersion() != API_VERSION) {
 			aRequest.setResponseErrorStr("Unsupported API version");
 			return websocketpp::http::status_code::precondition_failed;
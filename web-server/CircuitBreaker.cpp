@@ -0,0 +1,111 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/CircuitBreaker.h>
+
+#include <airdcpp/TimerManager.h>
+
+namespace webserver {
+	bool CircuitBreaker::allowCall() noexcept {
+		Lock l(cs);
+		switch (state) {
+			case STATE_CLOSED: return true;
+			case STATE_OPEN: {
+				if (GET_TICK() < openUntil) {
+					totalSkipped++;
+					return false;
+				}
+
+				state = STATE_HALF_OPEN;
+				probeStarted = GET_TICK();
+				return true;
+			}
+			case STATE_HALF_OPEN: {
+				// Allow a new probe if the result of the previous one was never reported
+				if (GET_TICK() < probeStarted + probeTimeout) {
+					totalSkipped++;
+					return false;
+				}
+
+				probeStarted = GET_TICK();
+				return true;
+			}
+		}
+
+		return true;
+	}
+
+	bool CircuitBreaker::onResult(bool aFailed, uint64_t aCallStarted) noexcept {
+		Lock l(cs);
+		if (aCallStarted < resultsValidFrom) {
+			// Stale result
+			return false;
+		}
+
+		if (!aFailed) {
+			state = STATE_CLOSED;
+			consecutiveFailures = 0;
+			return false;
+		}
+
+		consecutiveFailures++;
+		if (state == STATE_HALF_OPEN || (state == STATE_CLOSED && consecutiveFailures >= failureThreshold)) {
+			state = STATE_OPEN;
+			openUntil = GET_TICK() + openTime;
+			resultsValidFrom = GET_TICK();
+			totalOpened++;
+			return true;
+		}
+
+		return false;
+	}
+
+	void CircuitBreaker::reset() noexcept {
+		Lock l(cs);
+		state = STATE_CLOSED;
+		consecutiveFailures = 0;
+		resultsValidFrom = GET_TICK();
+	}
+
+	CircuitBreaker::State CircuitBreaker::getState() const noexcept {
+		Lock l(cs);
+		return state;
+	}
+
+	json CircuitBreaker::toJson() const noexcept {
+		Lock l(cs);
+
+		string stateStr;
+		switch (state) {
+			case STATE_CLOSED: stateStr = "closed"; break;
+			case STATE_OPEN: stateStr = "open"; break;
+			case STATE_HALF_OPEN: stateStr = "half_open"; break;
+		}
+
+		auto now = GET_TICK();
+		return {
+			{ "state", stateStr },
+			{ "consecutive_failures", consecutiveFailures },
+			{ "open_remaining_ms", state == STATE_OPEN && openUntil > now ? openUntil - now : 0 },
+			{ "skipped_calls", totalSkipped },
+			{ "opened_count", totalOpened },
+		};
+	}
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_CIRCUITBREAKER_H
+#define DCPLUSPLUS_DCPP_CIRCUITBREAKER_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	// Bypasses an unreliable remote party after repeated failures
+	// Once the open period has passed, a single probe call is let through (half-open state) 
+	// and its result decides whether the breaker is closed or opened again
+	class CircuitBreaker : boost::noncopyable {
+	public:
+		enum State {
+			STATE_CLOSED,
+			STATE_OPEN,
+			STATE_HALF_OPEN,
+		};
+
+		// Times are in milliseconds
+		CircuitBreaker(int aFailureThreshold, uint64_t aOpenTime, uint64_t aProbeTimeout) noexcept :
+			failureThreshold(aFailureThreshold), openTime(aOpenTime), probeTimeout(aProbeTimeout) { }
+
+		// Returns false if the call should be skipped
+		// The result of each allowed call must be reported with onResult
+		bool allowCall() noexcept;
+
+		// aCallStarted is the GET_TICK time when the call was allowed
+		// Results of calls started before the breaker was last opened or reset are ignored
+		// Returns true if the breaker was opened
+		bool onResult(bool aFailed, uint64_t aCallStarted) noexcept;
+
+		void reset() noexcept;
+
+		State getState() const noexcept;
+		json toJson() const noexcept;
+	private:
+		const int failureThreshold;
+		const uint64_t openTime;
+		const uint64_t probeTimeout;
+
+		State state = STATE_CLOSED;
+		int consecutiveFailures = 0;
+
+		// GET_TICK
+		uint64_t openUntil = 0;
+		uint64_t probeStarted = 0;
+		uint64_t resultsValidFrom = 0;
+
+		uint64_t totalSkipped = 0;
+		uint64_t totalOpened = 0;
+
+		mutable CriticalSection cs;
+	};
+}
+
+#endif
@@ -32,4 +32,38 @@ namespace webserver {
 
 	}
 
+	void ContextMenuManager::dispatchMenuListRequest(const string& aHookId, const json& aData, ContextMenuListRequest& aRequest) noexcept {
+		fire(ContextMenuManagerListener::MenuListRequested(), aHookId, aData, aRequest);
+	}
+
+	thread_local ContextMenuListRequest* ContextMenuListRequest::current = nullptr;
+
+	ContextMenuListRequest::ContextMenuListRequest() noexcept : prev(current) {
+		current = this;
+	}
+
+	ContextMenuListRequest::~ContextMenuListRequest() noexcept {
+		current = prev;
+
+		// Subscribers that weren't called (e.g. removed during the request)
+		for (const auto& a: pendingActions | map_values) {
+			a.cancelF();
+		}
+	}
+
+	void ContextMenuListRequest::addPendingAction(const void* aOwner, int aActionId, CancelF&& aCancelF) noexcept {
+		pendingActions.emplace(aOwner, PendingAction({ aActionId, std::move(aCancelF) }));
+	}
+
+	optional<int> ContextMenuListRequest::takePendingAction(const void* aOwner) noexcept {
+		auto i = pendingActions.find(aOwner);
+		if (i == pendingActions.end()) {
+			return nullopt;
+		}
+
+		auto id = i->second.actionId;
+		pendingActions.erase(i);
+		return id;
+	}
+
 } // namespace webserver
\ No newline at end of file
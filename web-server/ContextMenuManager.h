@@ -35,6 +35,7 @@
 #define CONTEXT_MENU(type, name, name2) \
 	ActionHook<ContextMenuItemList, const vector<type>&, const AccessList&, const ContextMenuSupportList&> name##MenuHook; \
 	ContextMenuItemList get##name2##Menu(const vector<type>& aItems, const AccessList& aAccessList, const ContextMenuSupportList& aSupports) const noexcept { \
+		ContextMenuListRequest request; \
 		return ActionHook<ContextMenuItemList>::normalizeListItems(name##MenuHook.runHooksData(aItems, aAccessList, aSupports)); \
 	} \
 	void onClick##name2##Item(const vector<type>& aItems, const ContextMenuItemClickData& aClickData) noexcept { \
@@ -45,6 +46,7 @@
 #define ENTITY_CONTEXT_MENU(type, name, name2, entityType) \
 	ActionHook<ContextMenuItemList, const vector<type>&, const AccessList&, const entityType&, const ContextMenuSupportList&> name##MenuHook; \
 	ContextMenuItemList get##name2##Menu(const vector<type>& aItems, const AccessList& aAccessList, const ContextMenuSupportList& aSupports, const entityType& aEntity) const noexcept { \
+		ContextMenuListRequest request; \
 		return ActionHook<ContextMenuItemList>::normalizeListItems(name##MenuHook.runHooksData(aItems, aAccessList, aEntity, aSupports)); \
 	} \
 	void onClick##name2##Item(const vector<type>& aItems, const ContextMenuItemClickData& aClickData, const entityType& aEntity) noexcept { \
@@ -55,6 +57,53 @@
 namespace webserver {
 	typedef StringList ContextMenuSupportList;
 
+	// Menu list hooks of all subscribers are dispatched concurrently when the first subscriber 
+	// handler is called. The results are then collected by the following handlers under a shared deadline.
+	// The request is valid for the calling thread during the ContextMenuManager::get*Menu call.
+	class ContextMenuListRequest : boost::noncopyable {
+	public:
+		typedef std::function<void()> CancelF;
+
+		ContextMenuListRequest() noexcept;
+		~ContextMenuListRequest() noexcept;
+
+		// Returns the request in progress for the calling thread (if any)
+		static ContextMenuListRequest* getCurrent() noexcept {
+			return current;
+		}
+
+		bool isDispatched() const noexcept {
+			return dispatched;
+		}
+
+		void setDispatched(uint64_t aDeadline) noexcept {
+			dispatched = true;
+			deadline = aDeadline;
+		}
+
+		// GET_TICK
+		uint64_t getDeadline() const noexcept {
+			return deadline;
+		}
+
+		// The cancel handler is called if the pending action isn't taken during the request
+		void addPendingAction(const void* aOwner, int aActionId, CancelF&& aCancelF) noexcept;
+		optional<int> takePendingAction(const void* aOwner) noexcept;
+	private:
+		struct PendingAction {
+			int actionId;
+			CancelF cancelF;
+		};
+
+		map<const void*, PendingAction> pendingActions;
+
+		bool dispatched = false;
+		uint64_t deadline = 0;
+
+		static thread_local ContextMenuListRequest* current;
+		ContextMenuListRequest* prev;
+	};
+
 	struct ContextMenuItemClickData {
 		ContextMenuItemClickData(const string& aHookId, const string& aMenuItemId, const ContextMenuSupportList& aSupports, const AccessList aAccess, const SettingValueMap aFormValues) noexcept :
 			hookId(aHookId), menuItemId(aMenuItemId), supports(aSupports), access(aAccess), formValues(aFormValues) {}
@@ -87,6 +136,8 @@ namespace webserver {
 		typedef X<18> HubMessageHighlightMenuSelected;
 		typedef X<19> PrivateChatMessageHighlightMenuSelected;
 
+		typedef X<30> MenuListRequested;
+
 
 		virtual void on(QueueBundleMenuSelected, const vector<uint32_t>&, const ContextMenuItemClickData&) noexcept { }
 		virtual void on(QueueFileMenuSelected, const vector<uint32_t>&, const ContextMenuItemClickData&) noexcept { }
@@ -103,6 +154,8 @@ namespace webserver {
 		virtual void on(HubUserMenuSelected, const vector<uint32_t>&, const ClientPtr&, const ContextMenuItemClickData&) noexcept { }
 		virtual void on(HubMessageHighlightMenuSelected, const vector<uint32_t>&, const ClientPtr&, const ContextMenuItemClickData&) noexcept { }
 		virtual void on(PrivateChatMessageHighlightMenuSelected, const vector<uint32_t>&, const PrivateChatPtr&, const ContextMenuItemClickData&) noexcept { }
+
+		virtual void on(MenuListRequested, const string& /*aHookId*/, const json& /*aData*/, ContextMenuListRequest&) noexcept { }
 	};
 
 	class ContextMenuItem {
@@ -144,6 +197,9 @@ namespace webserver {
 
 		typedef vector<ContextMenuItem> MenuItemList;
 
+		// Sends the menu list hook to all subscribers
+		void dispatchMenuListRequest(const string& aHookId, const json& aData, ContextMenuListRequest& aRequest) noexcept;
+
 		ContextMenuManager();
 		~ContextMenuManager();
 	private:
@@ -0,0 +1,197 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#include "stdinc.h"
+
+#include <web-server/EventBus.h>
+#include <web-server/Session.h>
+#include <web-server/WebSocket.h>
+
+#include <api/base/ApiModule.h>
+
+namespace webserver {
+	void EventBus::addModule(const string& aGroup, SubscribableApiModule* aModule) noexcept {
+		WLock l(cs);
+		auto& group = groups[aGroup];
+
+		dcassert(find(group.modules.begin(), group.modules.end(), aModule) == group.modules.end());
+		group.modules.push_back(aModule);
+		if (!group.publisher) {
+			group.publisher = aModule;
+		}
+	}
+
+	void EventBus::removeModule(const string& aGroup, SubscribableApiModule* aModule) noexcept {
+		WLock l(cs);
+		auto g = groups.find(aGroup);
+		if (g == groups.end()) {
+			return;
+		}
+
+		auto& group = g->second;
+		if (group.publisher == aModule) {
+			// Register the successor before the old publisher is removed so that the group always has a publisher
+			// The leaving module must still be listening to the core events; an event that is being fired during 
+			// the handoff is published by either of the modules (the successor has been added as a listener after the old publisher)
+			auto successor = find_if(group.modules.begin(), group.modules.end(), [aModule](const SubscribableApiModule* m) { 
+				return m != aModule; 
+			});
+
+			group.publisher = successor != group.modules.end() ? *successor : nullptr;
+			dcdebug("EventBus: publisher of the group %s changed\n", aGroup.c_str());
+		}
+
+		group.modules.erase(remove(group.modules.begin(), group.modules.end(), aModule), group.modules.end());
+		if (group.modules.empty()) {
+			groups.erase(g);
+		}
+	}
+
+	bool EventBus::isPublisher(const string& aGroup, const SubscribableApiModule* aModule) const noexcept {
+		RLock l(cs);
+		auto g = groups.find(aGroup);
+		return g != groups.end() && g->second.publisher == aModule;
+	}
+
+	bool EventBus::isReceiver(const SubscribableApiModule* aModule, SubscriptionId aSubscription) noexcept {
+		if (!aModule->getSocket() || !aModule->subscriptionActive(aSubscription)) {
+			return false;
+		}
+
+		// Permissions may have been changed after subscribing
+		return aModule->getSession()->getUser()->hasPermission(aModule->getSubscriptionAccess());
+	}
+
+	EventBus::SocketList EventBus::getReceivers(const Group& aGroup, SubscriptionId aSubscription) noexcept {
+		SocketList ret;
+		for (const auto& m: aGroup.modules) {
+			if (isReceiver(m, aSubscription)) {
+				auto socket = m->getSocket();
+				if (socket) {
+					ret.push_back(socket);
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	int EventBus::publish(const string& aGroup, const SubscribableApiModule* aPublisher, SubscriptionId aSubscription, const JsonCallback& aDataCallback, const json& aEntityId) noexcept {
+		SocketList receivers;
+
+		{
+			RLock l(cs);
+			auto g = groups.find(aGroup);
+			if (g == groups.end() || g->second.publisher != aPublisher) {
+				// Another module will send the event
+				return 0;
+			}
+
+			receivers = getReceivers(g->second, aSubscription);
+		}
+
+		if (receivers.empty()) {
+			return 0;
+		}
+
+		// Don't block joining and leaving modules while writing to sockets
+		return send(receivers, aPublisher->getSubscriptionName(aSubscription), aDataCallback, aEntityId);
+	}
+
+	int EventBus::send(const string& aGroup, const SubscribableApiModule* aSender, SubscriptionId aSubscription, const JsonCallback& aDataCallback, const json& aEntityId) noexcept {
+		SocketList receivers;
+
+		{
+			RLock l(cs);
+			auto g = groups.find(aGroup);
+			if (g == groups.end()) {
+				return 0;
+			}
+
+			receivers = getReceivers(g->second, aSubscription);
+		}
+
+		if (receivers.empty()) {
+			return 0;
+		}
+
+		return send(receivers, aSender->getSubscriptionName(aSubscription), aDataCallback, aEntityId);
+	}
+
+	int EventBus::send(const SocketList& aReceivers, const string& aSubscription, const JsonCallback& aDataCallback, const json& aEntityId) noexcept {
+		if (aReceivers.empty()) {
+			return 0;
+		}
+
+		// Serialize once
+		string data;
+		try {
+			json j = {
+				{ "event", aSubscription },
+				{ "data", aDataCallback() },
+			};
+
+			if (!aEntityId.is_null()) {
+				j["id"] = aEntityId;
+			}
+
+			data = j.dump();
+		} catch (const std::exception& e) {
+			dcdebug("EventBus: failed to serialize event %s: %s\n", aSubscription.c_str(), e.what());
+			return 0;
+		}
+
+		for (const auto& s: aReceivers) {
+			s->sendSerialized(data);
+		}
+
+		return static_cast<int>(aReceivers.size());
+	}
+
+	bool EventBus::hasReceivers(const string& aGroup, const SubscribableApiModule* aPublisher, SubscriptionId aSubscription) const noexcept {
+		RLock l(cs);
+
+		auto g = groups.find(aGroup);
+		if (g == groups.end() || g->second.publisher != aPublisher) {
+			return false;
+		}
+
+		return any_of(g->second.modules.begin(), g->second.modules.end(), [&](const SubscribableApiModule* aModule) {
+			return isReceiver(aModule, aSubscription);
+		});
+	}
+
+	void EventBus::onEventQueued(uint64_t aCaptureTimeNs, size_t aQueueSize) noexcept {
+		queuedEvents++;
+		captureTimeTotal += aCaptureTimeNs;
+
+		updateMax(captureTimeMax, aCaptureTimeNs);
+		updateMax(queueSizeMax, aQueueSize);
+	}
+
+	json EventBus::getQueueStats() const noexcept {
+		auto count = queuedEvents.load();
+		return {
+			{ "queued_events", count },
+			{ "capture_time_average_ns", count == 0 ? 0 : captureTimeTotal.load() / count },
+			{ "capture_time_max_ns", captureTimeMax.load() },
+			{ "queue_size_max", queueSizeMax.load() },
+		};
+	}
+}
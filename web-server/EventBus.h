@@ -0,0 +1,109 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+
+#ifndef DCPLUSPLUS_DCPP_EVENTBUS_H
+#define DCPLUSPLUS_DCPP_EVENTBUS_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	class SubscribableApiModule;
+
+	// Delivers identical events to subscribed modules of all sessions
+	//
+	// Modules listening to the same core event source should join the same group. Only one module 
+	// of each group (the publisher) forwards the core events to the bus so that each event will be 
+	// serialized once and the same encoded buffer is sent to every subscribed socket.
+	//
+	// The first module joining the group becomes the publisher. When the publisher leaves, the role is 
+	// handed to the oldest remaining module. The publisher check and the receiver snapshot are made atomically 
+	// so that each published event is sent by exactly one module.
+	//
+	// The modules of a group are instances of the same module type so the subscription IDs 
+	// of the publisher are valid for all of them.
+	class EventBus {
+	public:
+		typedef std::function<json()> JsonCallback;
+
+		EventBus() {}
+
+		void addModule(const string& aGroup, SubscribableApiModule* aModule) noexcept;
+		void removeModule(const string& aGroup, SubscribableApiModule* aModule) noexcept;
+
+		// Returns true if the module is responsible for publishing the events for the group
+		bool isPublisher(const string& aGroup, const SubscribableApiModule* aModule) const noexcept;
+
+		// Serializes the event (only if there are receivers) and sends it to all modules of the group
+		// that have the subscription active and the required permission
+		// Nothing is sent if aPublisher isn't the current publisher of the group
+		// Returns the number of receivers
+		int publish(const string& aGroup, const SubscribableApiModule* aPublisher, SubscriptionId aSubscription, const JsonCallback& aDataCallback, const json& aEntityId = nullptr) noexcept;
+
+		// Sends an event to the current receivers of the group without checking the publisher
+		// Used for queued events whose publisher was decided when the event was fired
+		int send(const string& aGroup, const SubscribableApiModule* aSender, SubscriptionId aSubscription, const JsonCallback& aDataCallback, const json& aEntityId = nullptr) noexcept;
+
+		// Returns true if aPublisher is the current publisher and any module of the group would receive the event
+		bool hasReceivers(const string& aGroup, const SubscribableApiModule* aPublisher, SubscriptionId aSubscription) const noexcept;
+
+		// Statistics for events queued from core threads (see SubscribableApiModule::publishAsync)
+		void onEventQueued(uint64_t aCaptureTimeNs, size_t aQueueSize) noexcept;
+		json getQueueStats() const noexcept;
+
+		EventBus(EventBus&) = delete;
+		EventBus& operator=(EventBus&) = delete;
+	private:
+		typedef vector<SubscribableApiModule*> ModuleList;
+		struct Group {
+			ModuleList modules;
+			const SubscribableApiModule* publisher = nullptr;
+		};
+
+		map<string, Group> groups;
+
+		static bool isReceiver(const SubscribableApiModule* aModule, SubscriptionId aSubscription) noexcept;
+
+		typedef vector<WebSocketPtr> SocketList;
+
+		// Returns the sockets of the receiving modules (the caller must hold the lock)
+		static SocketList getReceivers(const Group& aGroup, SubscriptionId aSubscription) noexcept;
+
+		// Serializes the event once and sends it to the sockets
+		static int send(const SocketList& aReceivers, const string& aSubscription, const JsonCallback& aDataCallback, const json& aEntityId) noexcept;
+
+		mutable SharedMutex cs;
+
+		template<typename T>
+		static void updateMax(atomic<T>& aMax, T aValue) noexcept {
+			auto cur = aMax.load();
+			while (aValue > cur && !aMax.compare_exchange_weak(cur, aValue)) {
+				// Another thread updated the value, retry
+			}
+		}
+
+		atomic<uint64_t> queuedEvents { 0 };
+		atomic<uint64_t> captureTimeTotal { 0 };
+		atomic<uint64_t> captureTimeMax { 0 };
+		atomic<size_t> queueSizeMax { 0 };
+	};
+}
+
+#endif
@@ -28,10 +28,22 @@
 
 #include <airdcpp/File.h>
 
+#ifndef _WIN32
+#include <sys/wait.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
 
 namespace webserver {
 	SharedMutex Extension::cs;
 
+#ifdef _WIN32
+	CriticalSection Extension::processCS;
+#endif
+
 	string Extension::getRootPath(const string& aName) noexcept {
 		return EXTENSION_DIR_ROOT + aName + PATH_SEPARATOR_STR;
 	}
@@ -54,6 +66,9 @@ namespace webserver {
 
 	Extension::Extension(const SessionPtr& aSession, const json& aPackageJson) : managed(false), session(aSession) {
 		initialize(aPackageJson);
+
+		// Remote extensions register themselves using the connected socket
+		readyState = STATE_CONNECTED;
 	}
 
 	Extension::~Extension() {
@@ -259,15 +274,70 @@ namespace webserver {
 		checkCompatibility();
 
 		session = wsm->getUserManager().createExtensionSession(name);
-		
-		createProcess(aEngine, wsm, session);
+		session->addListener(this);
+
+		// Set before launching so that an early socket connection won't be missed
+		setReadyState(STATE_STARTED);
+
+		try {
+			createProcess(aEngine, wsm, session);
+		} catch (const Exception&) {
+			session->removeListener(this);
+			wsm->getUserManager().logout(session);
+			session = nullptr;
+
+			setReadyState(STATE_STOPPED);
+			throw;
+		}
 
 		running = true;
 		fire(ExtensionListener::ExtensionStarted());
 
 		// Monitor the running state of the script
-		timer = wsm->addTimer([this, wsm] { checkRunningState(wsm); }, 2500);
-		timer->start(false);
+		startMonitoring(wsm);
+	}
+
+	string Extension::readyStateToString(ReadyState aState) noexcept {
+		switch (aState) {
+			case STATE_STARTED: return "started";
+			case STATE_CONNECTED: return "connected";
+			case STATE_READY: return "ready";
+			default: return "stopped";
+		}
+	}
+
+	void Extension::setReady() {
+		if (readyState == STATE_READY) {
+			return;
+		}
+
+		if (readyState != STATE_CONNECTED) {
+			throw Exception("The extension isn't connected");
+		}
+
+		setReadyState(STATE_READY);
+	}
+
+	void Extension::setReadyState(ReadyState aState) noexcept {
+		if (readyState.exchange(aState) == aState) {
+			return;
+		}
+
+		dcdebug("Extension %s: ready state changed to %s\n", name.c_str(), readyStateToString(aState).c_str());
+		fire(ExtensionListener::ReadyStateChanged());
+	}
+
+	void Extension::on(SessionListener::SocketConnected, const WebSocketPtr&) noexcept {
+		if (readyState == STATE_STARTED) {
+			setReadyState(STATE_CONNECTED);
+		}
+	}
+
+	void Extension::on(SessionListener::SocketDisconnected) noexcept {
+		// Hooks and subscriptions are removed with the socket
+		if (readyState == STATE_CONNECTED || readyState == STATE_READY) {
+			setReadyState(STATE_STARTED);
+		}
 	}
 
 	string Extension::getConnectUrl(WebServerManager* wsm) noexcept {
@@ -298,8 +368,12 @@ namespace webserver {
 		// Name
 		addParam("name", name);
 
-		// Connect URL
-		addParam("apiUrl", getConnectUrl(wsm));
+		// Connect via the local socket when it's available (access is limited to the current user)
+		if (wsm->isListeningUnix()) {
+			addParam("apiSocket", wsm->getUnixSocketPath());
+		} else {
+			addParam("apiUrl", getConnectUrl(wsm));
+		}
 
 		// Session token
 		addParam("authToken", aSession->getAuthToken());
@@ -324,7 +398,7 @@ namespace webserver {
 			return true;
 		}
 
-		timer->stop(false);
+		stopMonitoring(true);
 		if (!terminateProcess()) {
 			return false;
 		}
@@ -336,7 +410,8 @@ namespace webserver {
 	void Extension::onFailed(uint32_t aExitCode) noexcept {
 		dcdebug("Extension %s failed with code %u\n", name.c_str(), aExitCode);
 
-		timer->stop(false);
+		// Called from the monitor callback
+		stopMonitoring(false);
 
 		onStopped(true);
 
@@ -355,6 +430,7 @@ namespace webserver {
 		dcdebug("\n");
 
 		if (session) {
+			session->removeListener(this);
 			session->getServer()->getUserManager().logout(session);
 			session = nullptr;
 		}
@@ -364,6 +440,7 @@ namespace webserver {
 
 		dcassert(running);
 		running = false;
+		setReadyState(STATE_STOPPED);
 	}
 #ifdef _WIN32
 	void Extension::initLog(HANDLE& aHandle, const string& aPath) {
@@ -409,6 +486,8 @@ namespace webserver {
 	}
 
 	void Extension::createProcess(const string& aEngine, WebServerManager* wsm, const SessionPtr& aSession) {
+		Lock l(processCS);
+
 		// Setup log file for console output
 		initLog(messageLogHandle, getMessageLogPath());
 		initLog(errorLogHandle, getErrorLogPath());
@@ -470,16 +549,53 @@ namespace webserver {
 		disableLogInheritance(errorLogHandle);
 	}
 
-	void Extension::checkRunningState(WebServerManager*) noexcept {
+	void Extension::startMonitoring(WebServerManager*) {
+		processMonitor.reset(new ProcessMonitor({ weak_from_this(), piProcInfo.dwProcessId }));
+		if (!RegisterWaitForSingleObject(&processWaitHandle, piProcInfo.hProcess, &Extension::onProcessSignaled, processMonitor.get(), INFINITE, WT_EXECUTEONLYONCE)) {
+			dcdebug("Failed to monitor the extension process %s (%s)\n", name.c_str(), Util::translateError(::GetLastError()).c_str());
+			throw Exception("Failed to monitor the extension process");
+		}
+	}
+
+	void Extension::stopMonitoring(bool aWait) noexcept {
+		if (processWaitHandle) {
+			// Waiting isn't possible from the callback
+			UnregisterWaitEx(processWaitHandle, aWait ? INVALID_HANDLE_VALUE : NULL);
+			processWaitHandle = NULL;
+
+			if (aWait) {
+				// Otherwise the context is still being used by the callback
+				processMonitor.reset();
+			}
+		}
+	}
+
+	VOID CALLBACK Extension::onProcessSignaled(PVOID aContext, BOOLEAN) {
+		const auto& monitor = *static_cast<ProcessMonitor*>(aContext);
+		const auto processId = monitor.processId;
+
+		auto extension = monitor.extension.lock();
+		if (!extension || extension->piProcInfo.dwProcessId != processId) {
+			// Stopped or restarted meanwhile
+			return;
+		}
+
+		extension->checkRunningState();
+	}
+
+	bool Extension::checkRunningState() noexcept {
 		DWORD exitCode = 0;
 		if (GetExitCodeProcess(piProcInfo.hProcess, &exitCode) != 0) {
 			if (exitCode != STILL_ACTIVE) {
 				onFailed(exitCode);
+				return true;
 			}
 		} else {
 			dcdebug("Failed to check running state of extension %s (%s)\n", name.c_str(), Util::translateError(::GetLastError()).c_str());
 			dcassert(0);
 		}
+
+		return false;
 	}
 
 	void Extension::resetProcessState() noexcept {
@@ -490,6 +606,8 @@ namespace webserver {
 			CloseHandle(piProcInfo.hProcess);
 			piProcInfo.hProcess = INVALID_HANDLE_VALUE;
 		}
+
+		piProcInfo.dwProcessId = 0;
 	}
 
 	bool Extension::terminateProcess() noexcept {
@@ -503,9 +621,77 @@ namespace webserver {
 		return true;
 	}
 #else
-#include <sys/wait.h>
+	void Extension::startMonitoring(WebServerManager* wsm) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+		auto fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+		if (fd != -1) {
+			processDescriptor = make_unique<boost::asio::posix::stream_descriptor>(wsm->getTaskService(), fd);
+			processDescriptor->async_read_some(boost::asio::null_buffers(), [weakExtension = weak_from_this(), monitoredPid = pid](const boost::system::error_code& aError, size_t) {
+				if (aError) {
+					// Cancelled
+					return;
+				}
+
+				auto extension = weakExtension.lock();
+				if (!extension || extension->pid != monitoredPid) {
+					// Stopped or restarted meanwhile
+					return;
+				}
+
+				extension->checkRunningState();
+			});
+			return;
+		}
+
+		dcdebug("pidfd_open failed for extension %s (%s), using SIGCHLD instead\n", name.c_str(), Util::translateError(errno).c_str());
+#endif
+
+		childSignals = make_unique<boost::asio::signal_set>(wsm->getTaskService(), SIGCHLD);
+		waitProcessSignal(shared_from_this(), pid);
+
+		// The process may have exited before the signal handler was registered
+		checkRunningState();
+	}
+
+	void Extension::waitProcessSignal(const ExtensionPtr& aExtension, pid_t aPid) noexcept {
+		aExtension->childSignals->async_wait([weakExtension = weak_ptr<Extension>(aExtension), aPid](const boost::system::error_code& aError, int) {
+			if (aError) {
+				// Cancelled
+				return;
+			}
+
+			auto extension = weakExtension.lock();
+			if (!extension || extension->pid != aPid || !extension->childSignals) {
+				// Stopped or restarted meanwhile
+				return;
+			}
+
+			// The signal may be for another child process
+			if (!extension->checkRunningState()) {
+				waitProcessSignal(extension, aPid);
+			}
+		});
+	}
+
+	void Extension::stopMonitoring(bool) noexcept {
+		boost::system::error_code ec;
+		if (processDescriptor) {
+			processDescriptor->close(ec);
+			processDescriptor.reset();
+		}
+
+		if (childSignals) {
+			childSignals->cancel(ec);
+			childSignals.reset();
+		}
+	}
+
+	bool Extension::checkRunningState() noexcept {
+		if (pid <= 0) {
+			// waitpid would reap any child process
+			return false;
+		}
 
-	void Extension::checkRunningState(WebServerManager* wsm) noexcept {
 		int status = 0;
 		if (waitpid(pid, &status, WNOHANG) != 0) {
 			int exitCode = 1;
@@ -514,7 +700,10 @@ namespace webserver {
 			}
 
 			onFailed(exitCode);
+			return true;
 		}
+
+		return false;
 	}
 
 	void Extension::resetProcessState() noexcept {
@@ -567,7 +756,7 @@ namespace webserver {
 			dup2(messageLog->getNativeHandle(), STDOUT_FILENO);
 			dup2(errorLog->getNativeHandle(), STDERR_FILENO);
 
-			// Run, checkRunningState will handle errors...
+			// Run, the process monitor will handle errors...
 			if (execvp(aEngine.c_str(), &argv[0]) == -1) {
 				fprintf(stderr, "Failed to start the extension %s: %s\n", name.c_str(), Util::translateError(errno).c_str());
 			}
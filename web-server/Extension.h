@@ -22,20 +22,34 @@
 #include "stdinc.h"
 
 #include <web-server/ExtensionListener.h>
+#include <web-server/SessionListener.h>
 #include <web-server/ApiSettingItem.h>
 
+#include <airdcpp/CriticalSection.h>
 #include <airdcpp/GetSet.h>
 #include <airdcpp/Speaker.h>
 #include <airdcpp/User.h>
 #include <airdcpp/Util.h>
 
+#ifndef _WIN32
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/signal_set.hpp>
+#endif
+
 namespace webserver {
 #define EXTENSION_DIR_ROOT Util::getPath(Util::PATH_USER_CONFIG) + "extensions" + PATH_SEPARATOR_STR
 
-	class Extension : public Speaker<ExtensionListener> {
+	class Extension : public Speaker<ExtensionListener>, private SessionListener, public std::enable_shared_from_this<Extension> {
 	public:
 		typedef std::function<void(Extension*, uint32_t /*exitCode*/)> ErrorF;
 
+		enum ReadyState {
+			STATE_STOPPED,
+			STATE_STARTED, // Process launched
+			STATE_CONNECTED, // API socket connected
+			STATE_READY, // Hooks and other initial registrations completed (signaled by the extension)
+		};
+
 		// Throws on errors
 		Extension(const string& aPackageDirectory, ErrorF&& aErrorF, bool aSkipPathValidation = false);
 		Extension(const SessionPtr& aSession, const json& aPackageJson);
@@ -82,6 +96,16 @@ namespace webserver {
 			return running;
 		}
 
+		ReadyState getReadyState() const noexcept {
+			return readyState;
+		}
+
+		static string readyStateToString(ReadyState aState) noexcept;
+
+		// Called by the extension after it has finished its initial registrations
+		// Throws on errors
+		void setReady();
+
 		bool isPrivate() const noexcept {
 			return privateExtension;
 		}
@@ -131,6 +155,12 @@ namespace webserver {
 		static string getConnectUrl(WebServerManager* wsm) noexcept;
 
 		bool running = false;
+		atomic<ReadyState> readyState { STATE_STOPPED };
+
+		void setReadyState(ReadyState aState) noexcept;
+
+		void on(SessionListener::SocketConnected, const WebSocketPtr&) noexcept override;
+		void on(SessionListener::SocketDisconnected) noexcept override;
 
 		// Throws on errors
 		void createProcess(const string& aEngine, WebServerManager* wsm, const SessionPtr& aSession);
@@ -138,24 +168,51 @@ namespace webserver {
 		const ErrorF errorF;
 		SessionPtr session = nullptr;
 
-		void checkRunningState(WebServerManager* wsm) noexcept;
+		// The process exit is detected without polling (process handle wait on Windows, pidfd or SIGCHLD on other systems)
+		// The monitor callbacks only hold a weak reference to the extension and they are ignored if the process has changed
+		void startMonitoring(WebServerManager* wsm);
+		void stopMonitoring(bool aWait) noexcept;
+
+		// Returns true if the process has exited
+		bool checkRunningState() noexcept;
 		void onFailed(uint32_t aExitCode) noexcept;
 		void onStopped(bool aFailed) noexcept;
-		TimerPtr timer = nullptr;
 
 		bool terminateProcess() noexcept;
 		void resetProcessState() noexcept;
 #ifdef _WIN32
+		// Extensions launched concurrently must not inherit each other's log handles
+		static CriticalSection processCS;
+
 		static void initLog(HANDLE& aHandle, const string& aPath);
 		static void disableLogInheritance(HANDLE& aHandle);
 		static void closeLog(HANDLE& aHandle);
 
+		static VOID CALLBACK onProcessSignaled(PVOID aContext, BOOLEAN aTimedOut);
+
+		// Context of the process wait callback
+		struct ProcessMonitor {
+			weak_ptr<Extension> extension;
+			DWORD processId;
+		};
+
+		unique_ptr<ProcessMonitor> processMonitor;
+
 		PROCESS_INFORMATION piProcInfo;
 		HANDLE messageLogHandle = INVALID_HANDLE_VALUE;
 		HANDLE errorLogHandle = INVALID_HANDLE_VALUE;
+		HANDLE processWaitHandle = NULL;
 #else
 		static unique_ptr<File> initLog(const string& aPath);
 		pid_t pid = 0;
+
+		static void waitProcessSignal(const ExtensionPtr& aExtension, pid_t aPid) noexcept;
+
+		// Becomes readable when the process exits (Linux 5.3 or newer)
+		unique_ptr<boost::asio::posix::stream_descriptor> processDescriptor;
+
+		// Fallback for systems without pidfd support
+		unique_ptr<boost::asio::signal_set> childSignals;
 #endif
 	};
 
@@ -35,6 +35,7 @@ namespace webserver {
 		typedef X<3> SettingDefinitionsUpdated;
 
 		typedef X<4> PackageUpdated;
+		typedef X<5> ReadyStateChanged;
 
 
 		virtual void on(ExtensionStarted) noexcept { }
@@ -43,6 +44,7 @@ namespace webserver {
 		virtual void on(SettingValuesUpdated, const SettingValueMap&) noexcept { }
 		virtual void on(SettingDefinitionsUpdated) noexcept { }
 		virtual void on(PackageUpdated) noexcept { }
+		virtual void on(ReadyStateChanged) noexcept { }
 	};
 
 }
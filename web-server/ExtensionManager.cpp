@@ -24,13 +24,16 @@
 #include <web-server/WebServerManager.h>
 #include <web-server/WebSocket.h>
 
-#include <airdcpp/CryptoManager.h>
 #include <airdcpp/Encoder.h>
 #include <airdcpp/File.h>
 #include <airdcpp/HttpDownload.h>
 #include <airdcpp/ScopedFunctor.h>
-#include <airdcpp/ZUtils.h>
+#include <airdcpp/Thread.h>
+#include <airdcpp/TimerManager.h>
 
+#include <openssl/sha.h>
+
+#define EXT_INSTALL_CHUNK_SIZE 64 * 1024
 
 namespace webserver {
 	ExtensionManager::ExtensionManager(WebServerManager* aWsm) : wsm(aWsm) {
@@ -51,10 +54,19 @@ namespace webserver {
 	}
 
 	void ExtensionManager::on(WebServerManagerListener::Started) noexcept {
+		stopping = false;
 		load();
 	}
 
 	void ExtensionManager::on(WebServerManagerListener::Stopping) noexcept {
+		// Queued startup tasks will be skipped, wait for the ones that are launching a process
+		stopping = true;
+		notifyStartupState();
+
+		while (runningStartups > 0) {
+			Thread::sleep(50);
+		}
+
 		RLock l(cs);
 		for (const auto& ext: extensions) {
 			ext->removeListeners();
@@ -66,6 +78,7 @@ namespace webserver {
 		WLock l(cs);
 		dcassert(all_of(extensions.begin(), extensions.end(), [](const ExtensionPtr& aExtension) { return !aExtension->getSession(); }));
 		extensions.clear();
+		startupExtensions.clear();
 	}
 
 	void ExtensionManager::on(WebServerManagerListener::SocketDisconnected, const WebSocketPtr& aSocket) noexcept {
@@ -97,12 +110,63 @@ namespace webserver {
 	void ExtensionManager::load() noexcept {
 		auto directories = File::findFiles(EXTENSION_DIR_ROOT, "*", File::TYPE_DIRECTORY);
 
+		ExtensionList loaded;
 		for (const auto& path : directories) {
 			auto ext = loadLocalExtension(path);
-			if (ext && startExtensionImpl(ext)) {
-				wsm->log(STRING_F(WEB_EXTENSION_LOADED, ext->getName()), LogMessage::SEV_INFO);
+			if (ext) {
+				loaded.push_back(ext);
 			}
 		}
+
+		{
+			WLock l(cs);
+			startupExtensions = loaded;
+		}
+
+		// Launching involves engine lookups and process creation, don't wait for the previous extension
+		pendingStartups += static_cast<int>(loaded.size());
+		for (const auto& ext : loaded) {
+			ext->addListener(this);
+			wsm->addAsyncTask([=] {
+				if (startExtensionImpl(ext)) {
+					wsm->log(STRING_F(WEB_EXTENSION_LOADED, ext->getName()), LogMessage::SEV_INFO);
+				}
+
+				pendingStartups--;
+				notifyStartupState();
+			});
+		}
+	}
+
+	void ExtensionManager::on(ExtensionListener::ReadyStateChanged) noexcept {
+		notifyStartupState();
+	}
+
+	void ExtensionManager::notifyStartupState() noexcept {
+		{
+			// Don't notify between the predicate check and the wait of a waiting thread
+			std::lock_guard<std::mutex> l(startupStateMutex);
+		}
+
+		startupStateChanged.notify_all();
+	}
+
+	bool ExtensionManager::isStartupReady() const noexcept {
+		if (pendingStartups > 0) {
+			return false;
+		}
+
+		RLock l(cs);
+		return all_of(startupExtensions.begin(), startupExtensions.end(), [](const ExtensionPtr& aExtension) {
+			return !aExtension->isRunning() || aExtension->getReadyState() == Extension::STATE_READY;
+		});
+	}
+
+	bool ExtensionManager::waitStartupReady(uint64_t aTimeoutMs) const noexcept {
+		std::unique_lock<std::mutex> l(startupStateMutex);
+		return startupStateChanged.wait_for(l, std::chrono::milliseconds(aTimeoutMs), [this] {
+			return stopping || isStartupReady();
+		}) && !stopping;
 	}
 
 	ExtensionList ExtensionManager::getExtensions() const noexcept {
@@ -155,102 +219,110 @@ namespace webserver {
 	}
 
 	void ExtensionManager::onExtensionDownloadCompleted(const string& aInstallId, const string& aUrl, const string& aSha1) noexcept {
-		auto tempFile = Util::getTempPath() + Util::validateFileName(aUrl) + ".tmp";
-
 		// Don't allow the same download to be initiated again until the installation has finished
 		ScopedFunctor([&]() {
-			File::deleteFile(tempFile);
-
 			WLock l(cs);
 			httpDownloads.erase(aUrl);
 		});
 
+		HttpDownloadMap::mapped_type download = nullptr;
+
+		// Get the download
 		{
-			HttpDownloadMap::mapped_type download = nullptr;
+			WLock l(cs);
+			auto i = httpDownloads.find(aUrl);
+			if (i == httpDownloads.end()) {
+				dcassert(0);
+				return;
+			}
 
-			// Get the download
-			{
-				WLock l(cs);
-				auto i = httpDownloads.find(aUrl);
-				if (i == httpDownloads.end()) {
-					dcassert(0);
-					return;
-				}
+			download = i->second;
+		}
 
-				download = i->second;
-			}
+		if (download->buf.empty()) {
+			failInstallation(aInstallId, STRING(WEB_EXTENSION_DOWNLOAD_FAILED), download->status);
+			return;
+		}
+
+		const auto tempRoot = getTempExtensionRoot(Util::validateFileName(aUrl));
+		ScopedFunctor([&tempRoot]() {
+			removeTempExtensionRoot(tempRoot);
+		});
+
+		const auto& buf = download->buf;
+
+		// Validate the possible checksum before anything is written on disk
+		if (!aSha1.empty()) {
+			uint8_t digest[SHA_DIGEST_LENGTH];
+			SHA1(reinterpret_cast<const unsigned char*>(buf.data()), buf.size(), digest);
 
-			if (download->buf.empty()) {
-				failInstallation(aInstallId, STRING(WEB_EXTENSION_DOWNLOAD_FAILED), download->status);
+			char mdString[SHA_DIGEST_LENGTH * 2 + 1];
+			for (int i = 0; i < SHA_DIGEST_LENGTH; i++)
+				sprintf(&mdString[i * 2], "%02x", digest[i]);
+
+			if (compare(string(mdString), aSha1) != 0) {
+				failInstallation(aInstallId, STRING(WEB_EXTENSION_DOWNLOAD_FAILED), STRING(WEB_EXTENSION_CHECKSUM_MISMATCH));
 				return;
 			}
+		}
 
-			// Validate the possible checksum
-			if (!aSha1.empty()) {
-				auto calculatedSha1 = CryptoManager::calculateSha1(download->buf);
-				if (calculatedSha1) {
-					char mdString[SHA_DIGEST_LENGTH * 2 + 1];
-					for (int i = 0; i < SHA_DIGEST_LENGTH; i++)
-						sprintf(&mdString[i * 2], "%02x", (*calculatedSha1)[i]);
-
-					if (compare(string(mdString), aSha1) != 0) {
-						failInstallation(aInstallId, STRING(WEB_EXTENSION_DOWNLOAD_FAILED), STRING(WEB_EXTENSION_CHECKSUM_MISMATCH));
-						return;
-					}
-				}
+		// Extract the package in chunks
+		try {
+			TarFile tar(tempRoot);
+			for (size_t pos = 0; pos < buf.size(); pos += EXT_INSTALL_CHUNK_SIZE) {
+				const auto len = min(buf.size() - pos, static_cast<size_t>(EXT_INSTALL_CHUNK_SIZE));
+				tar.writeGzip(buf.data() + pos, len);
 			}
 
-			// Save on disk
-			try {
-				File(tempFile, File::WRITE, File::CREATE | File::TRUNCATE).write(download->buf);
-			} catch (const FileException& e) {
-				failInstallation(aInstallId, STRING(WEB_EXTENSION_PACKAGE_SAVE_FAILED), e.what());
-				return;
-			}
+			tar.finish();
+		} catch (const Exception& e) {
+			failInstallation(aInstallId, STRING(WEB_EXTENSION_PACKAGE_EXTRACT_FAILED), e.getError());
+			return;
 		}
 
 		// Install
-		installLocalExtension(aInstallId, tempFile);
+		installExtractedExtension(aInstallId, tempRoot);
 	}
 
-	void ExtensionManager::installLocalExtension(const string& aInstallId, const string& aInstallFilePath) noexcept {
-		string tarFile = aInstallFilePath + "_DECOMPRESSED";
-		ScopedFunctor([&tarFile]() { 
-			auto success = File::deleteFile(tarFile);
-			dcassert(success);
-		});
+	string ExtensionManager::getTempExtensionRoot(const string& aPackageName) noexcept {
+		return Util::getTempPath() + "extension_" + aPackageName + PATH_SEPARATOR_STR;
+	}
 
+	void ExtensionManager::removeTempExtensionRoot(const string& aTempRoot) noexcept {
 		try {
-			GZ::decompress(aInstallFilePath, tarFile);
-		} catch (const Exception& e) {
-			failInstallation(aInstallId, STRING(WEB_EXTENSION_PACKAGE_EXTRACT_FAILED), e.what());
-			return;
+			File::removeDirectoryForced(aTempRoot);
+		} catch (const FileException& e) {
+			dcdebug("Failed to delete the temporary extension directory %s: %s\n", aTempRoot.c_str(), e.getError().c_str());
 		}
+	}
 
-		string tempRoot = Util::getTempPath() + "extension_" + Util::getFileName(aInstallFilePath) + PATH_SEPARATOR_STR;
+	void ExtensionManager::installLocalExtension(const string& aInstallId, const string& aInstallFilePath) noexcept {
+		const auto tempRoot = getTempExtensionRoot(Util::getFileName(aInstallFilePath));
 		ScopedFunctor([&tempRoot]() {
-			try {
-				File::removeDirectoryForced(tempRoot);
-			} catch (const FileException& e) {
-				dcdebug("Failed to delete the temporary extension directory %s: %s\n", tempRoot.c_str(), e.getError().c_str());
-			}
+			removeTempExtensionRoot(tempRoot);
 		});
 
 		try {
 			// Unpack the content to temp directory for validation purposes
-			TarFile tar(tarFile);
-			tar.extract(tempRoot);
+			TarFile tar(tempRoot);
+			tar.extractGzipFile(aInstallFilePath);
+			tar.finish();
 		} catch (const Exception& e) {
 			failInstallation(aInstallId, STRING(WEB_EXTENSION_PACKAGE_EXTRACT_FAILED), e.what());
 			return;
 		}
 
+		installExtractedExtension(aInstallId, tempRoot);
+	}
+
+	void ExtensionManager::installExtractedExtension(const string& aInstallId, const string& aTempRoot) noexcept {
 		// Parse the extension directory
 		string tempPackageDirectory;
 		{
-			auto directories = File::findFiles(tempRoot, "*", File::TYPE_DIRECTORY);
+			auto directories = File::findFiles(aTempRoot, "*", File::TYPE_DIRECTORY);
 			if (directories.size() != 1) {
 				failInstallation(aInstallId, STRING(WEB_EXTENSION_PACKAGE_MALFORMED_CONTENT), "There should be a single directory directly inside the extension package");
+				return;
 			}
 
 			tempPackageDirectory = directories.front();
@@ -358,29 +430,79 @@ namespace webserver {
 	}
 
 #define EXIT_CODE_TIMEOUT 124
+
+// The first restart is performed immediately, subsequent ones are delayed exponentially
+#define RESTART_DELAY_BASE_MS 1000
+#define RESTART_DELAY_MAX_MS 60 * 1000
+
+// Restart attempts are reset if the extension stays running at least this long
+#define RESTART_RESET_MS 5 * 60 * 1000
+
+// Crashing extensions are given up after this many restarts (without a reset in between)
+#define RESTART_MAX_ATTEMPTS 10
+
+	time_t ExtensionManager::getRestartDelay(const string& aName) noexcept {
+		WLock l(cs);
+		auto& state = restartStates[aName];
+
+		const auto now = GET_TICK();
+		if (state.lastRestart + RESTART_RESET_MS < now) {
+			state.attempts = 0;
+		}
+
+		if (state.attempts >= RESTART_MAX_ATTEMPTS) {
+			return -1;
+		}
+
+		auto delay = state.attempts == 0 ? 0 : min<time_t>(static_cast<time_t>(RESTART_DELAY_BASE_MS) << min(state.attempts - 1, 16), RESTART_DELAY_MAX_MS);
+
+		state.attempts++;
+		state.lastRestart = now + delay;
+		return delay;
+	}
+
 	void ExtensionManager::onExtensionFailed(const Extension* aExtension, uint32_t aExitCode) noexcept {
-		if (aExitCode == EXIT_CODE_TIMEOUT) {
-			// Attempt to restart it (but outside of extension's timer thread)
-			auto name = aExtension->getName();
-			wsm->addAsyncTask([=] {
-				auto extension = getExtension(name);
-				if (extension && startExtensionImpl(extension)) {
-					wsm->log(STRING_F(WEB_EXTENSION_TIMED_OUT, aExtension->getName()), LogMessage::SEV_INFO);
-				}
-			});
-		} else {
+		auto name = aExtension->getName();
+		if (aExitCode != EXIT_CODE_TIMEOUT) {
 			if (WEBCFG(EXTENSIONS_DEBUG_MODE).boolean()) {
 				wsm->log(
-					"Extension " + aExtension->getName() + " exited with code " + Util::toString(aExitCode), 
+					"Extension " + name + " exited with code " + Util::toString(aExitCode), 
 					LogMessage::SEV_ERROR
 				);
 			}
 
 			wsm->log(
-				STRING_F(WEB_EXTENSION_EXITED, aExtension->getName() % aExtension->getErrorLogPath()),
+				STRING_F(WEB_EXTENSION_EXITED, name % aExtension->getErrorLogPath()),
 				LogMessage::SEV_ERROR
 			);
-		 }
+
+			if (aExitCode == 0) {
+				// Exited on its own
+				return;
+			}
+		}
+
+		// Attempt to restart timed out and crashed extensions (but outside of extension's monitor thread)
+		auto delay = getRestartDelay(name);
+		if (delay < 0) {
+			wsm->log("Extension " + name + " won't be restarted because it has failed too many times", LogMessage::SEV_ERROR);
+			return;
+		}
+
+		dcdebug("Restarting extension %s in %d ms\n", name.c_str(), static_cast<int>(delay));
+
+		auto restartF = [=] {
+			auto extension = getExtension(name);
+			if (extension && !extension->isRunning() && startExtensionImpl(extension) && aExitCode == EXIT_CODE_TIMEOUT) {
+				wsm->log(STRING_F(WEB_EXTENSION_TIMED_OUT, name), LogMessage::SEV_INFO);
+			}
+		};
+
+		if (delay == 0) {
+			wsm->addAsyncTask(restartF);
+		} else {
+			wsm->addDelayedTask(restartF, delay);
+		}
 	}
 
 	ExtensionPtr ExtensionManager::loadLocalExtension(const string& aPath) noexcept {
@@ -411,6 +533,15 @@ namespace webserver {
 	}
 
 	bool ExtensionManager::startExtensionImpl(const ExtensionPtr& aExtension) noexcept {
+		runningStartups++;
+		ScopedFunctor([this] {
+			runningStartups--;
+		});
+
+		if (stopping) {
+			return false;
+		}
+
 		try {
 			auto command = getStartCommand(aExtension->getEngines());
 			aExtension->start(command, wsm);
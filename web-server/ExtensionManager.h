@@ -26,21 +26,34 @@
 #include <airdcpp/Speaker.h>
 #include <airdcpp/Util.h>
 
+#include <web-server/ExtensionListener.h>
 #include <web-server/ExtensionManagerListener.h>
 #include <web-server/WebServerManagerListener.h>
 
+#include <condition_variable>
+#include <mutex>
+
 namespace dcpp {
 	struct HttpDownload;
 }
 
 namespace webserver {
-	class ExtensionManager: public Speaker<ExtensionManagerListener>, private WebServerManagerListener {
+	class ExtensionManager: public Speaker<ExtensionManagerListener>, private WebServerManagerListener, private ExtensionListener {
 	public:
 		ExtensionManager(WebServerManager* aWsm);
 		~ExtensionManager();
 
+		// Load and launch all installed extensions (the processes are started concurrently)
 		void load() noexcept;
 
+		// Returns true when all extensions launched by load() have signaled that they are ready (or have stopped)
+		bool isStartupReady() const noexcept;
+
+		// Optional gate for work that depends on extension hooks (e.g. share refresh)
+		// Blocks until the extensions launched on startup are ready, the server is stopping or the timeout expires
+		// Returns false if the extensions didn't become ready
+		bool waitStartupReady(uint64_t aTimeoutMs) const noexcept;
+
 		// Download extension from the given URL and install it
 		// SHA1 checksum is optional
 		// Returns false if the extension is being downloaded already
@@ -71,11 +84,29 @@ namespace webserver {
 		static string selectEngineCommand(const string& aEngineCommands) noexcept;
 	private:
 		void onExtensionFailed(const Extension* aExtension, uint32_t aExitCode) noexcept;
+
+		struct RestartState {
+			int attempts = 0;
+			uint64_t lastRestart = 0;
+		};
+
+		// Extensions that have been restarted after failures
+		map<string, RestartState> restartStates;
+
+		// Returns the delay (ms) for the next restart attempt of the extension
+		// Returns -1 if the extension has failed too many times and it shouldn't be restarted anymore
+		time_t getRestartDelay(const string& aName) noexcept;
 		bool startExtensionImpl(const ExtensionPtr& aExtension) noexcept;
 
 		EngineMap engines;
 
 		void onExtensionDownloadCompleted(const string& aInstallId, const string& aUrl, const string& aSha1) noexcept;
+
+		// Validates and installs a package that has been extracted to the temp directory
+		void installExtractedExtension(const string& aInstallId, const string& aTempRoot) noexcept;
+
+		static string getTempExtensionRoot(const string& aPackageName) noexcept;
+		static void removeTempExtensionRoot(const string& aTempRoot) noexcept;
 		void failInstallation(const string& aInstallId, const string& aMessage, const string& aException) noexcept;
 
 		typedef map<string, shared_ptr<HttpDownload>> HttpDownloadMap;
@@ -89,12 +120,28 @@ namespace webserver {
 
 		ExtensionList extensions;
 
+		// Extensions launched by load()
+		ExtensionList startupExtensions;
+		atomic<int> pendingStartups { 0 };
+
+		// Wakes the threads in waitStartupReady when the startup state changes
+		void notifyStartupState() noexcept;
+		mutable std::mutex startupStateMutex;
+		mutable std::condition_variable startupStateChanged;
+
+		// Extensions aren't started after the server has begun stopping
+		// The stop handler waits for the startups that are in progress
+		atomic<bool> stopping { false };
+		atomic<int> runningStartups { 0 };
+
 		WebServerManager* wsm;
 
 		void on(WebServerManagerListener::Started) noexcept override;
 		void on(WebServerManagerListener::Stopping) noexcept override;
 		void on(WebServerManagerListener::Stopped) noexcept override;
 		void on(WebServerManagerListener::SocketDisconnected, const WebSocketPtr& aSocket) noexcept override;
+
+		void on(ExtensionListener::ReadyStateChanged) noexcept override;
 	};
 }
 
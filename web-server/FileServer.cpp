@@ -30,22 +30,29 @@
 #include <airdcpp/Thread.h>
 #include <airdcpp/Util.h>
 
-#include <airdcpp/HttpDownload.h>
 #include <airdcpp/ScopedFunctor.h>
 #include <airdcpp/ViewFileManager.h>
 
 #include <sstream>
 
+// Limit the memory usage of partial requests (media players will request the remaining data separately)
+#define MAX_VIEW_RESPONSE_SIZE 16LL*1024LL*1024LL
+#define MAX_VIEW_RANGES 20
+
+#define MAX_PROXY_DOWNLOAD_SIZE 20*1024*1024
+#define PROXY_CACHE_SIZE 64*1024*1024
+#define PROXY_CACHE_MAX_AGE 60*60*1000 // 1 hour
+
 namespace webserver {
 	using namespace dcpp;
 
-	FileServer::FileServer() {
+	FileServer::FileServer() : proxyCache(PROXY_CACHE_SIZE) {
 	}
 
 	FileServer::~FileServer() {
 		RLock l(cs);
 		for (const auto& f: tempFiles) {
-			File::deleteFile(f.second);
+			File::deleteFile(f.second.path);
 		}
 	}
 
@@ -55,6 +62,7 @@ namespace webserver {
 
 	void FileServer::setResourcePath(const string& aPath) noexcept {
 		resourcePath = Util::validatePath(aPath, true);
+		resourceCache.clear();
 	}
 
 	string FileServer::getExtension(const string& aResource) noexcept {
@@ -79,12 +87,6 @@ namespace webserver {
 		if (!extension.empty()) {
 			dcassert(extension[0] != '.');
 
-			// We have compressed versions only for JS files
-			if (extension == "js" && aRequest.get_header("Accept-Encoding").find("gzip") != string::npos) {
-				request += ".gz";
-				headers_.emplace_back("Content-Encoding", "gzip");
-			}
-
 			if (extension != "html" && aResource != "/sw.js") {
 				// File versioning is done with hashes in filenames (except for the index file and service worker)
 				HttpUtil::addCacheControlHeader(headers_, 365);
@@ -151,7 +153,7 @@ namespace webserver {
 	}
 
 	websocketpp::http::status_code::value FileServer::handlePostRequest(const websocketpp::http::parser::request& aRequest,
-		std::string& output_, StringPairList& headers_, const SessionPtr& aSession) noexcept {
+		std::string& output_, StringPairList& headers_, const SessionPtr& aSession, const FileDeferredHandler& aDeferF) noexcept {
 
 		const auto& requestPath = aRequest.get_uri();
 		if (requestPath == "/temp") {
@@ -160,34 +162,68 @@ namespace webserver {
 				return websocketpp::http::status_code::unauthorized;
 			}
 
-			const auto fileName = Util::toString(Util::rand());
-			const auto filePath = Util::getTempPath() + fileName;
-
-			try {
-				File file(filePath, File::WRITE, File::TRUNCATE | File::CREATE, File::BUFFER_SEQUENTIAL);
-				file.write(aRequest.get_body());
-			} catch (const FileException& e) {
-				output_ = "Failed to write the file: " + e.getError();
-				return websocketpp::http::status_code::internal_server_error;
-			}
-
-			{
-				WLock l(cs);
-				tempFiles.emplace(fileName, filePath);
-			}
+			// Writing and hashing large files takes a while, don't block the IO thread
+			// The completion handler keeps the connection (and the request body) alive until the response has been sent
+			auto completionF = aDeferF();
+			pendingTempFiles++;
+			WebServerManager::getInstance()->addAsyncTask([this, completionF, &aRequest] {
+				storeTempFile(aRequest.get_body(), completionF);
+				pendingTempFiles--;
+			});
 
-			headers_.emplace_back("Location", fileName);
-			return websocketpp::http::status_code::created;
+			return websocketpp::http::status_code::accepted;
 		}
 
 		output_ = "Requested resource was not found";
 		return websocketpp::http::status_code::not_found;
 	}
 
-	string FileServer::getTempFilePath(const string& fileId) const noexcept {
+	void FileServer::storeTempFile(const string& aData, const HTTPFileCompletionF& aCompletionF) noexcept {
+		const auto fileName = Util::toString(Util::rand());
+		const auto filePath = Util::getTempPath() + fileName;
+
+		TTHValue tth;
+		try {
+			tth = writeTempFile(filePath, aData);
+		} catch (const FileException& e) {
+			aCompletionF(websocketpp::http::status_code::internal_server_error, "Failed to write the file: " + e.getError(), StringPairList());
+			return;
+		}
+
+		{
+			WLock l(cs);
+			tempFiles.emplace(fileName, TempFile({ filePath, static_cast<int64_t>(aData.size()), tth }));
+		}
+
+		StringPairList headers;
+		headers.emplace_back("Location", fileName);
+		aCompletionF(websocketpp::http::status_code::created, Util::emptyString, headers);
+	}
+
+	TTHValue FileServer::writeTempFile(const string& aPath, const string& aData) {
+		File file(aPath, File::WRITE, File::TRUNCATE | File::CREATE, File::BUFFER_SEQUENTIAL);
+		TigerTree tree(TigerTree::calcBlockSize(aData.size(), 10));
+
+		// Hash each chunk right after writing it while the data is still in the CPU cache
+		const size_t chunkSize = 1024 * 1024;
+		for (size_t pos = 0; pos < aData.size(); pos += chunkSize) {
+			auto len = min(chunkSize, aData.size() - pos);
+			file.write(aData.data() + pos, len);
+			tree.update(aData.data() + pos, len);
+		}
+
+		tree.finalize();
+		return tree.getRoot();
+	}
+
+	optional<FileServer::TempFile> FileServer::getTempFile(const string& aFileId) const noexcept {
 		RLock l(cs);
-		auto i = tempFiles.find(fileId);
-		return i != tempFiles.end() ? i->second : Util::emptyString;
+		auto i = tempFiles.find(aFileId);
+		if (i == tempFiles.end()) {
+			return nullopt;
+		}
+
+		return i->second;
 	}
 
 	websocketpp::http::status_code::value FileServer::handleRequest(const websocketpp::http::parser::request& aRequest,
@@ -196,7 +232,7 @@ namespace webserver {
 		if (aRequest.get_method() == "GET") {
 			return handleGetRequest(aRequest, output_, headers_, aSession, aDeferF);
 		} else if (aRequest.get_method() == "POST") {
-			return handlePostRequest(aRequest, output_, headers_, aSession);
+			return handlePostRequest(aRequest, output_, headers_, aSession, aDeferF);
 		}
 
 		output_ = "Requested resource was not found";
@@ -214,14 +250,24 @@ namespace webserver {
 		try {
 			if (requestUrl.length() >= 6 && requestUrl.compare(0, 6, "/view/") == 0) {
 				filePath = parseViewFilePath(requestUrl.substr(6), headers_, aSession);
+			} else if (requestUrl == "/metrics") {
+				if (!aSession || !aSession->getUser()->hasPermission(Access::ADMIN)) {
+					throw RequestException(websocketpp::http::status_code::unauthorized, "Not authorized");
+				}
+
+				output_ = WebServerManager::getInstance()->getApiMetrics().toPrometheus();
+				headers_.emplace_back("Content-Type", "text/plain; version=0.0.4");
+				HttpUtil::addCacheControlHeader(headers_, 0);
+				return websocketpp::http::status_code::ok;
 			} else if (requestUrl.length() >= 6 && requestUrl.compare(0, 6, "/proxy") == 0) {
 				if (!aSession) {
 					throw RequestException(websocketpp::http::status_code::unauthorized, "Not authorized");
 				}
 
-				return handleProxyDownload(requestUrl, output_, aDeferF);
+				return handleProxyDownload(requestUrl, output_, headers_, aDeferF);
 			} else {
 				filePath = parseResourcePath(requestUrl, aRequest, headers_);
+				return handleResourceRequest(filePath, aRequest, output_, headers_);
 			}
 		} catch (const RequestException& e) {
 			output_ = e.what();
@@ -229,15 +275,40 @@ namespace webserver {
 		}
 
 		auto fileSize = File::getSize(filePath);
-		int64_t startPos = 0, endPos = fileSize - 1;
 
-		auto partialContent = HttpUtil::parsePartialRange(aRequest.get_header("Range"), startPos, endPos);
+		HttpUtil::RangeList ranges;
+		auto partialContent = HttpUtil::parsePartialRanges(aRequest.get_header("Range"), fileSize, ranges);
+		if (partialContent) {
+			limitRanges(ranges);
+		}
+
+		const auto type = HttpUtil::getMimeType(filePath);
 
 		// Read file
 		try {
 			File f(filePath, File::READ, File::OPEN);
-			f.setPos(startPos);
-			output_ = f.read(static_cast<size_t>(endPos) + 1);
+			if (!partialContent) {
+				output_ = f.read();
+			} else if (ranges.size() == 1) {
+				output_ = readRange(f, ranges.front());
+			} else {
+				const auto boundary = Util::toString(Util::rand()) + Util::toString(Util::rand());
+				for (const auto& r: ranges) {
+					output_ += "\r\n--" + boundary + "\r\n";
+					if (type) {
+						output_ += "Content-Type: " + string(type) + "\r\n";
+					}
+
+					output_ += "Content-Range: " + HttpUtil::formatPartialRange(r.first, r.second, fileSize) + "\r\n\r\n";
+					output_ += readRange(f, r);
+				}
+
+				output_ += "\r\n--" + boundary + "--\r\n";
+
+				headers_.emplace_back("Content-Type", "multipart/byteranges; boundary=" + boundary);
+				headers_.emplace_back("Accept-Ranges", "bytes");
+				return websocketpp::http::status_code::partial_content;
+			}
 		} catch (const FileException& e) {
 			dcdebug("Failed to serve the file %s: %s\n", filePath.c_str(), e.getError().c_str());
 			output_ = e.getError();
@@ -262,25 +333,107 @@ namespace webserver {
 			}
 		}
 
-		{
-			// Get the mime type (but get it from the original request with gzipped content)
-			auto usingEncoding = find_if(headers_.begin(), headers_.end(), CompareFirst<string, string>("Content-Encoding")) != headers_.end();
-			auto type = HttpUtil::getMimeType(usingEncoding ? requestUrl : filePath);
-			if (type) {
-				headers_.emplace_back("Content-Type", type);
-			}
+		if (type) {
+			headers_.emplace_back("Content-Type", type);
 		}
 
+		headers_.emplace_back("Accept-Ranges", "bytes");
 		if (partialContent) {
-			headers_.emplace_back("Content-Range", HttpUtil::formatPartialRange(startPos, endPos, fileSize));
-			headers_.emplace_back("Accept-Ranges", "bytes");
+			headers_.emplace_back("Content-Range", HttpUtil::formatPartialRange(ranges.front().first, ranges.front().second, fileSize));
 			return websocketpp::http::status_code::partial_content;
 		}
 
 		return websocketpp::http::status_code::ok;
 	}
 
-	websocketpp::http::status_code::value FileServer::handleProxyDownload(const string& aRequestUrl, string& output_, const FileDeferredHandler& aDeferF) noexcept {
+	string FileServer::readRange(File& aFile, const pair<int64_t, int64_t>& aRange) {
+		aFile.setPos(aRange.first);
+		return aFile.read(static_cast<size_t>(aRange.second - aRange.first + 1));
+	}
+
+	void FileServer::limitRanges(HttpUtil::RangeList& ranges_) noexcept {
+		int64_t totalSize = 0;
+		for (const auto& r: ranges_) {
+			totalSize += r.second - r.first + 1;
+		}
+
+		if (ranges_.size() > MAX_VIEW_RANGES || totalSize > MAX_VIEW_RESPONSE_SIZE) {
+			// Serve only the beginning of the first range, the client will request the rest separately
+			ranges_.resize(1);
+		}
+
+		auto& first = ranges_.front();
+		first.second = min(first.second, first.first + MAX_VIEW_RESPONSE_SIZE - 1);
+	}
+
+	websocketpp::http::status_code::value FileServer::handleResourceRequest(const string& aFilePath, const websocketpp::http::parser::request& aRequest,
+		string& output_, StringPairList& headers_) noexcept {
+
+		ResourceCache::Resource::Ptr resource;
+		try {
+			resource = resourceCache.getResource(aFilePath);
+		} catch (const FileException& e) {
+			dcdebug("Failed to serve the file %s: %s\n", aFilePath.c_str(), e.getError().c_str());
+			output_ = e.getError();
+			return websocketpp::http::status_code::not_found;
+		}
+
+		// Pick the content encoding with the highest quality value (the compressed ones are preferred on ties)
+		const string* content = nullptr;
+		const string* eTag = nullptr;
+		string encoding;
+
+		{
+			const auto& acceptEncoding = aRequest.get_header("Accept-Encoding");
+
+			double bestQuality = 0;
+			auto addCandidate = [&](const string& aData, const string& aETag, const string& aEncoding) {
+				if (aData.empty()) {
+					return;
+				}
+
+				auto quality = HttpUtil::getEncodingQuality(acceptEncoding, aEncoding.empty() ? "identity" : aEncoding);
+				if (quality > bestQuality) {
+					bestQuality = quality;
+					content = &aData;
+					eTag = &aETag;
+					encoding = aEncoding;
+				}
+			};
+
+			addCandidate(resource->brotliData, resource->brotliETag, "br");
+			addCandidate(resource->gzipData, resource->gzipETag, "gzip");
+			addCandidate(resource->data, resource->eTag, Util::emptyString);
+		}
+
+		if (!content) {
+			output_ = "None of the available content encodings is accepted";
+			return websocketpp::http::status_code::not_acceptable;
+		}
+
+		headers_.emplace_back("ETag", *eTag);
+		headers_.emplace_back("Vary", "Accept-Encoding");
+
+		if (HttpUtil::matchesETag(aRequest.get_header("If-None-Match"), *eTag)) {
+			return websocketpp::http::status_code::not_modified;
+		}
+
+		if (!encoding.empty()) {
+			headers_.emplace_back("Content-Encoding", encoding);
+		}
+
+		{
+			auto type = HttpUtil::getMimeType(aFilePath);
+			if (type) {
+				headers_.emplace_back("Content-Type", type);
+			}
+		}
+
+		output_ = *content;
+		return websocketpp::http::status_code::ok;
+	}
+
+	websocketpp::http::status_code::value FileServer::handleProxyDownload(const string& aRequestUrl, string& output_, StringPairList& headers_, const FileDeferredHandler& aDeferF) noexcept {
 		string protocol, host, port, path, query, fragment;
 		Util::decodeUrl(aRequestUrl, protocol, host, port, path, query, fragment);
 
@@ -296,65 +449,84 @@ namespace webserver {
 			return websocketpp::http::status_code::bad_request;
 		}
 
+		{
+			uint64_t remainingMillis = 0;
+			auto cached = proxyCache.get(proxyUrl, remainingMillis);
+			if (cached) {
+				output_ = *cached;
+				HttpUtil::addCacheControlHeaderSeconds(headers_, static_cast<int>(remainingMillis / 1000));
+				return websocketpp::http::status_code::ok;
+			}
+		}
+
 		auto completionHandler = aDeferF();
 
-		auto downloadId = proxyDownloadCounter++;
-		auto download = std::make_shared<HttpDownload>(
-			proxyUrl,
-			[=]() {
-				onProxyDownloadCompleted(downloadId, completionHandler);
-			}
-		);
+		ProxyDownload::Ptr download;
 
 		{
 			WLock l(cs);
+			auto downloadId = proxyDownloadCounter++;
+			download = ProxyDownload::create(
+				WebServerManager::getInstance()->getIOService(),
+				MAX_PROXY_DOWNLOAD_SIZE,
+				[=](const ProxyDownload::Result& aResult) {
+					onProxyDownloadCompleted(downloadId, proxyUrl, aResult, completionHandler);
+				}
+			);
+
 			proxyDownloads.emplace(downloadId, download);
 		}
 
+		download->start(proxyUrl);
 		return websocketpp::http::status_code::accepted;
 	}
 
-	void FileServer::onProxyDownloadCompleted(int64_t aDownloadId, const HTTPFileCompletionF& aCompletionF) noexcept {
-		ScopedFunctor([&] {
+	void FileServer::onProxyDownloadCompleted(int64_t aDownloadId, const string& aUrl, const ProxyDownload::Result& aResult, const HTTPFileCompletionF& aCompletionF) noexcept {
+		{
 			WLock l(cs);
 			proxyDownloads.erase(aDownloadId);
-		});
+		}
 
-		shared_ptr<HttpDownload> d = nullptr;
+		if (!aResult.error.empty()) {
+			aCompletionF(websocketpp::http::status_code::bad_gateway, aResult.error, StringPairList());
+			return;
+		}
 
-		{
-			RLock l(cs);
-			auto i = proxyDownloads.find(aDownloadId);
-			if (i != proxyDownloads.end()) {
-				d = i->second;
-			}
+		if (aResult.status != websocketpp::http::status_code::ok) {
+			aCompletionF(static_cast<websocketpp::http::status_code::value>(aResult.status), aResult.statusText, StringPairList());
+			return;
 		}
 
-		dcassert(d);
-		if (d) {
-			if (d->buf.empty()) {
-				int statusCode;
-				string statusText;
-				if (HttpUtil::parseStatus(d->status, statusCode, statusText)) {
-					aCompletionF(static_cast<websocketpp::http::status_code::value>(statusCode), statusText, StringPairList());
-				} else {
-					aCompletionF(websocketpp::http::status_code::not_acceptable, d->status, StringPairList());
-				}
-			} else {
-				StringPairList headers;
-				HttpUtil::addCacheControlHeader(headers, 0);
-				aCompletionF(websocketpp::http::status_code::ok, d->buf, headers);
+		StringPairList headers;
+		if (!aResult.storable) {
+			// Pass the directives on so that the browser won't store the file either
+			headers.emplace_back("Cache-Control", aResult.cacheControl);
+		} else {
+			auto maxAge = aResult.maxAge >= 0 ? min<uint64_t>(aResult.maxAge * 1000, PROXY_CACHE_MAX_AGE) : PROXY_CACHE_MAX_AGE;
+			if (maxAge > 0) {
+				proxyCache.put(aUrl, aResult.body, maxAge);
 			}
+
+			HttpUtil::addCacheControlHeaderSeconds(headers, static_cast<int>(maxAge / 1000));
 		}
+
+		aCompletionF(websocketpp::http::status_code::ok, aResult.body, headers);
 	}
 
 	void FileServer::stop() noexcept {
+		{
+			RLock l(cs);
+			for (const auto& d: proxyDownloads | map_values) {
+				d->cancel();
+			}
+		}
+
 		for (;;) {
 			bool hasDownloads;
 
 			{
 				RLock l(cs);
-				hasDownloads = !proxyDownloads.empty();
+				hasDownloads = !proxyDownloads.empty() || pendingTempFiles > 0;
 			}
 
 			if (hasDownloads) {
@@ -21,7 +21,13 @@
 
 #include "stdinc.h"
 
+#include <web-server/HttpUtil.h>
+#include <web-server/ProxyCache.h>
+#include <web-server/ProxyDownload.h>
+#include <web-server/ResourceCache.h>
+
 #include <airdcpp/typedefs.h>
+#include <airdcpp/MerkleTree.h>
 #include <airdcpp/CriticalSection.h>
 
 
@@ -37,30 +43,58 @@ namespace webserver {
 		websocketpp::http::status_code::value handleRequest(const websocketpp::http::parser::request& aRequest, 
 			std::string& output_, StringPairList& headers_, const SessionPtr& aSession, const FileDeferredHandler& aDeferF);
 
-		string getTempFilePath(const string& fileId) const noexcept;
+		struct TempFile {
+			string path;
+			int64_t size;
+
+			// Calculated while the file is being written
+			TTHValue tth;
+		};
+
+		optional<TempFile> getTempFile(const string& aFileId) const noexcept;
 		void stop() noexcept;
 	private:
 		websocketpp::http::status_code::value handleGetRequest(const websocketpp::http::parser::request& aRequest,
 			std::string& output_, StringPairList& headers_, const SessionPtr& aSession, const FileDeferredHandler& aDeferF);
 
-		websocketpp::http::status_code::value handleProxyDownload(const string& aUrl, string& output_, const FileDeferredHandler& aDeferF) noexcept;
-		void onProxyDownloadCompleted(int64_t aDownloadId, const HTTPFileCompletionF& aCompletionF) noexcept;
+		// Serve a file from the resource cache
+		websocketpp::http::status_code::value handleResourceRequest(const string& aFilePath, const websocketpp::http::parser::request& aRequest,
+			std::string& output_, StringPairList& headers_) noexcept;
+
+		websocketpp::http::status_code::value handleProxyDownload(const string& aUrl, string& output_, StringPairList& headers_, const FileDeferredHandler& aDeferF) noexcept;
+		void onProxyDownloadCompleted(int64_t aDownloadId, const string& aUrl, const ProxyDownload::Result& aResult, const HTTPFileCompletionF& aCompletionF) noexcept;
 
 		websocketpp::http::status_code::value handlePostRequest(const websocketpp::http::parser::request& aRequest,
-			std::string& output_, StringPairList& headers_, const SessionPtr& aSession) noexcept;
+			std::string& output_, StringPairList& headers_, const SessionPtr& aSession, const FileDeferredHandler& aDeferF) noexcept;
 
 		string resourcePath;
+		ResourceCache resourceCache;
 
 		string parseResourcePath(const string& aResource, const websocketpp::http::parser::request& aRequest, StringPairList& headers_) const;
 		string parseViewFilePath(const string& aResource, StringPairList& headers_, const SessionPtr& aSession) const;
 
 		static string getExtension(const string& aResource) noexcept;
 
+		// Limit the size and count of the requested ranges
+		static void limitRanges(HttpUtil::RangeList& ranges_) noexcept;
+
+		// Throws FileException
+		static string readRange(File& aFile, const pair<int64_t, int64_t>& aRange);
+
 		mutable SharedMutex cs;
-		StringMap tempFiles;
+		map<string, TempFile> tempFiles;
+
+		// Writes the data in chunks and calculates the TTH at the same time
+		// Throws FileException
+		static TTHValue writeTempFile(const string& aPath, const string& aData);
+
+		// Runs in a task thread
+		void storeTempFile(const string& aData, const HTTPFileCompletionF& aCompletionF) noexcept;
+		atomic<int> pendingTempFiles { 0 };
 
 		int64_t proxyDownloadCounter = 0;
-		map<int64_t, std::shared_ptr<HttpDownload>> proxyDownloads;
+		map<int64_t, ProxyDownload::Ptr> proxyDownloads;
+		ProxyCache proxyCache;
 	};
 }
 
@@ -23,6 +23,7 @@
 #include <airdcpp/Util.h>
 
 #include "boost/algorithm/string/replace.hpp"
+#include "boost/algorithm/string/trim.hpp"
 
 //#include <sstream>
 
@@ -126,7 +127,11 @@ namespace webserver {
 	}
 
 	void HttpUtil::addCacheControlHeader(StringPairList& headers_, int aDaysValid) noexcept {
-		headers_.emplace_back("Cache-Control", aDaysValid == 0 ? "no-store" : "max-age=" + Util::toString(aDaysValid * 24 * 60 * 60));
+		addCacheControlHeaderSeconds(headers_, aDaysValid * 24 * 60 * 60);
+	}
+
+	void HttpUtil::addCacheControlHeaderSeconds(StringPairList& headers_, int aSecondsValid) noexcept {
+		headers_.emplace_back("Cache-Control", aSecondsValid == 0 ? "no-store" : "max-age=" + Util::toString(aSecondsValid));
 	}
 
 	string HttpUtil::formatPartialRange(int64_t aStartPos, int64_t aEndPos, int64_t aFileSize) noexcept {
@@ -134,44 +139,127 @@ namespace webserver {
 		return "bytes " + Util::toString(aStartPos) + "-" + Util::toString(aEndPos) + "/" + Util::toString(aFileSize);
 	}
 
-	// Support partial requests will enhance media file playback
-	// This will only support simple range values (unsupported range types will be ignored)
-	bool HttpUtil::parsePartialRange(const string& aHeaderData, int64_t& start_, int64_t& end_) noexcept {
-		if (aHeaderData.find("bytes=") != 0) {
-			return false;
+	bool HttpUtil::matchesETag(const string& aIfNoneMatch, const string& aETag) noexcept {
+		auto stripWeak = [](string& tag_) {
+			if (tag_.compare(0, 2, "W/") == 0) {
+				tag_.erase(0, 2);
+			}
+		};
+
+		auto eTag = aETag;
+		stripWeak(eTag);
+
+		StringTokenizer<string> tags(aIfNoneMatch, ',');
+		for (auto tag: tags.getTokens()) {
+			boost::algorithm::trim(tag);
+			if (tag == "*") {
+				return true;
+			}
+
+			stripWeak(tag);
+			if (tag == eTag) {
+				return true;
+			}
 		}
 
-		dcdebug("Partial HTTP request: %s)\n", aHeaderData.c_str());
+		return false;
+	}
 
-		auto tokenizer = StringTokenizer<string>(aHeaderData.substr(6), '-', true);
-		if (tokenizer.getTokens().size() != 2) {
-			dcdebug("Partial HTTP request: unsupported range\n");
-			return false;
+	double HttpUtil::getEncodingQuality(const string& aAcceptEncoding, const string& aEncoding) noexcept {
+		double wildcardQuality = -1;
+
+		StringTokenizer<string> codings(aAcceptEncoding, ',');
+		for (const auto& coding: codings.getTokens()) {
+			StringTokenizer<string> params(coding, ';');
+			auto& tokens = params.getTokens();
+			if (tokens.empty()) {
+				continue;
+			}
+
+			auto name = boost::algorithm::trim_copy(tokens.front());
+
+			double quality = 1;
+			for (auto i = tokens.begin() + 1; i != tokens.end(); ++i) {
+				auto param = boost::algorithm::trim_copy(*i);
+				if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+					quality = max(0.0, min(Util::toDouble(param.substr(2)), 1.0));
+				}
+			}
+
+			if (Util::stricmp(name, aEncoding) == 0) {
+				return quality;
+			}
+
+			if (name == "*") {
+				wildcardQuality = quality;
+			}
 		}
 
-		auto parsedStart = Util::toInt64(tokenizer.getTokens().at(0));
+		if (wildcardQuality >= 0) {
+			return wildcardQuality;
+		}
+
+		return aEncoding == "identity" ? 1 : 0;
+	}
 
-		// Not "parsedStart >= end_" because Safari seems to request one byte past the end (shouldn't be an issue when reading the file)
-		if (parsedStart > end_ || parsedStart < 0) {
-			dcdebug("Partial HTTP request: start position not accepted (" I64_FMT ")\n", parsedStart);
+	// Support partial requests will enhance media file playback
+	// Unsatisfiable ranges are skipped and the whole header is ignored if it contains invalid range specs
+	bool HttpUtil::parsePartialRanges(const string& aHeaderData, int64_t aFileSize, RangeList& ranges_) noexcept {
+		if (aHeaderData.find("bytes=") != 0 || aFileSize <= 0) {
 			return false;
 		}
 
-		const auto& endToken = tokenizer.getTokens().at(1);
-		if (endToken.empty()) {
-			end_ = end_ - start_;
-		} else {
-			auto parsedEnd = Util::toInt64(endToken);
-			if (parsedEnd > end_ || parsedEnd <= parsedStart) {
-				dcdebug("Partial HTTP request: end position not accepted (parsed start: " I64_FMT ", parsed end: " I64_FMT ", file size: " I64_FMT ")\n", parsedStart, parsedEnd, end_);
+		dcdebug("Partial HTTP request: %s)\n", aHeaderData.c_str());
+
+		RangeList ret;
+		StringTokenizer<string> specs(aHeaderData.substr(6), ',');
+		for (auto spec: specs.getTokens()) {
+			boost::algorithm::trim(spec);
+
+			auto sep = spec.find('-');
+			if (sep == string::npos) {
+				dcdebug("Partial HTTP request: unsupported range %s\n", spec.c_str());
 				return false;
 			}
 
-			end_ = parsedEnd;
+			const auto startToken = spec.substr(0, sep);
+			const auto endToken = spec.substr(sep + 1);
+
+			int64_t start, end;
+			if (startToken.empty()) {
+				// Suffix range (last N bytes)
+				auto suffixLength = Util::toInt64(endToken);
+				if (endToken.empty() || suffixLength <= 0) {
+					return false;
+				}
+
+				start = max(aFileSize - suffixLength, static_cast<int64_t>(0));
+				end = aFileSize - 1;
+			} else {
+				start = Util::toInt64(startToken);
+				end = endToken.empty() ? aFileSize - 1 : Util::toInt64(endToken);
+				if (start < 0 || end < start) {
+					dcdebug("Partial HTTP request: invalid range %s\n", spec.c_str());
+					return false;
+				}
+
+				// Safari seems to request one byte past the end
+				end = min(end, aFileSize - 1);
+			}
+
+			if (start >= aFileSize) {
+				dcdebug("Partial HTTP request: start position not accepted (" I64_FMT ")\n", start);
+				continue;
+			}
+
+			ret.emplace_back(start, end);
+		}
+
+		if (ret.empty()) {
+			return false;
 		}
 
-		// Both values were passed successfully
-		start_ = parsedStart;
+		ranges_.swap(ret);
 		return true;
 	}
 
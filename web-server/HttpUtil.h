@@ -31,14 +31,24 @@ namespace webserver {
 		static bool unespaceUrl(const std::string& in, std::string& out) noexcept;
 		static string getExtension(const string& aResource) noexcept;
 
-		// Parses start and end position from a range HTTP request field
-		// Initial value of end_ should be the file size
-		// Returns true if the partial range was parsed successfully
-		static bool parsePartialRange(const string& aHeaderData, int64_t& start_, int64_t& end_) noexcept;
+		// Start and end positions (inclusive)
+		typedef vector<pair<int64_t, int64_t>> RangeList;
+
+		// Parses the byte ranges from a range HTTP request field
+		// Returns true if at least one satisfiable range was parsed successfully
+		static bool parsePartialRanges(const string& aHeaderData, int64_t aFileSize, RangeList& ranges_) noexcept;
 
 		static string formatPartialRange(int64_t aStart, int64_t aEnd, int64_t aFileSize) noexcept;
 
+		// Returns true if the ETag is listed in the If-None-Match header value (weak comparison)
+		static bool matchesETag(const string& aIfNoneMatch, const string& aETag) noexcept;
+
+		// Returns the quality value (0-1) of the content coding in the Accept-Encoding header value
+		// Codings that aren't listed are acceptable only via a wildcard ("identity" is acceptable by default)
+		static double getEncodingQuality(const string& aAcceptEncoding, const string& aEncoding) noexcept;
+
 		static void addCacheControlHeader(StringPairList& headers_, int aDaysValid) noexcept;
+		static void addCacheControlHeaderSeconds(StringPairList& headers_, int aSecondsValid) noexcept;
 
 		static bool isStatusOk(int aCode) noexcept;
 		static bool parseStatus(const string& aResponse, int& code_, string& text_) noexcept;
@@ -0,0 +1,117 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_LATENCYHISTOGRAM_H
+#define DCPLUSPLUS_DCPP_LATENCYHISTOGRAM_H
+
+#include "stdinc.h"
+
+namespace webserver {
+	// Fixed-bucket histogram for durations
+	// Lock-free so that it's cheap enough to be used for all requests and tasks
+	class LatencyHistogram : boost::noncopyable {
+	public:
+		// Upper bounds of the buckets (microseconds), the last bucket is unbounded
+		static constexpr size_t BUCKET_COUNT = 17;
+		static constexpr uint64_t bucketBounds[BUCKET_COUNT] = {
+			50, 100, 250, 500,
+			1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+			1000000, 2500000, 5000000, 10000000
+		};
+
+		void add(uint64_t aMicros) noexcept {
+			auto bucket = lower_bound(begin(bucketBounds), end(bucketBounds), aMicros) - begin(bucketBounds);
+			buckets[bucket]++;
+
+			count++;
+			sum += aMicros;
+		}
+
+		void add(std::chrono::steady_clock::duration aDuration) noexcept {
+			add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(aDuration).count()));
+		}
+
+		uint64_t getCount() const noexcept {
+			return count;
+		}
+
+		uint64_t getSum() const noexcept {
+			return sum;
+		}
+
+		// Returns the upper bound of the bucket containing the percentile (aPercentile = 0...1)
+		uint64_t getPercentile(double aPercentile) const noexcept {
+			auto total = count.load();
+			if (total == 0) {
+				return 0;
+			}
+
+			auto target = static_cast<uint64_t>(ceil(aPercentile * static_cast<double>(total)));
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < BUCKET_COUNT; i++) {
+				cumulative += buckets[i];
+				if (cumulative >= target) {
+					return bucketBounds[i];
+				}
+			}
+
+			// Unbounded bucket
+			return bucketBounds[BUCKET_COUNT - 1];
+		}
+
+		json toJson() const noexcept {
+			auto total = count.load();
+			return {
+				{ "count", total },
+				{ "average_us", total == 0 ? 0 : sum.load() / total },
+				{ "p50_us", getPercentile(0.50) },
+				{ "p95_us", getPercentile(0.95) },
+				{ "p99_us", getPercentile(0.99) },
+			};
+		}
+
+		// Appends the histogram in Prometheus text format (values in seconds)
+		// aLabels should be in format label1="value1",label2="value2" (or empty)
+		void appendPrometheus(string& out_, const string& aName, const string& aLabels) const noexcept {
+			const auto labelPrefix = aLabels.empty() ? string() : aLabels + ",";
+
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < BUCKET_COUNT; i++) {
+				cumulative += buckets[i];
+				out_ += aName + "_bucket{" + labelPrefix + "le=\"" + formatSeconds(bucketBounds[i]) + "\"} " + Util::toString(cumulative) + "\n";
+			}
+
+			const auto labels = aLabels.empty() ? string() : "{" + aLabels + "}";
+			out_ += aName + "_bucket{" + labelPrefix + "le=\"+Inf\"} " + Util::toString(count.load()) + "\n";
+			out_ += aName + "_sum" + labels + " " + formatSeconds(sum.load()) + "\n";
+			out_ += aName + "_count" + labels + " " + Util::toString(count.load()) + "\n";
+		}
+	private:
+		static string formatSeconds(uint64_t aMicros) noexcept {
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%.6f", static_cast<double>(aMicros) / 1000000.0);
+			return buf;
+		}
+
+		atomic<uint64_t> buckets[BUCKET_COUNT + 1] = {};
+		atomic<uint64_t> count { 0 };
+		atomic<uint64_t> sum { 0 };
+	};
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/ProxyCache.h>
+
+#include <airdcpp/TimerManager.h>
+
+namespace webserver {
+	ProxyCache::DataPtr ProxyCache::get(const string& aUrl, uint64_t& remainingMillis_) noexcept {
+		Lock l(cs);
+		auto i = urlMap.find(aUrl);
+		if (i == urlMap.end()) {
+			return nullptr;
+		}
+
+		auto entry = i->second;
+		auto tick = GET_TICK();
+		if (entry->expires <= tick) {
+			removeEntry(entry);
+			return nullptr;
+		}
+
+		remainingMillis_ = entry->expires - tick;
+
+		// Move to front
+		entries.splice(entries.begin(), entries, entry);
+		return entry->data;
+	}
+
+	void ProxyCache::put(const string& aUrl, const string& aData, uint64_t aMaxAgeMillis) noexcept {
+		if (aData.size() > maxSize || aMaxAgeMillis == 0) {
+			return;
+		}
+
+		Lock l(cs);
+		{
+			auto i = urlMap.find(aUrl);
+			if (i != urlMap.end()) {
+				removeEntry(i->second);
+			}
+		}
+
+		// Evict the least recently used entries
+		while (!entries.empty() && totalSize + aData.size() > maxSize) {
+			removeEntry(prev(entries.end()));
+		}
+
+		entries.push_front({ aUrl, make_shared<const string>(aData), GET_TICK() + aMaxAgeMillis });
+		urlMap.emplace(aUrl, entries.begin());
+		totalSize += aData.size();
+	}
+
+	void ProxyCache::clear() noexcept {
+		Lock l(cs);
+		urlMap.clear();
+		entries.clear();
+		totalSize = 0;
+	}
+
+	void ProxyCache::removeEntry(EntryList::iterator aEntry) noexcept {
+		totalSize -= aEntry->data->size();
+		urlMap.erase(aEntry->url);
+		entries.erase(aEntry);
+	}
+}
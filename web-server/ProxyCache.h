@@ -0,0 +1,62 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_PROXYCACHE_H
+#define DCPLUSPLUS_DCPP_PROXYCACHE_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	// Size-limited LRU cache for the files fetched via the /proxy handler
+	class ProxyCache {
+	public:
+		typedef shared_ptr<const string> DataPtr;
+
+		explicit ProxyCache(size_t aMaxSize) : maxSize(aMaxSize) { }
+
+		// Returns nullptr if the URL isn't cached or the entry has expired
+		// The time left until the entry expires is stored in remainingMillis_
+		DataPtr get(const string& aUrl, uint64_t& remainingMillis_) noexcept;
+		void put(const string& aUrl, const string& aData, uint64_t aMaxAgeMillis) noexcept;
+
+		void clear() noexcept;
+	private:
+		struct Entry {
+			string url;
+			DataPtr data;
+			uint64_t expires;
+		};
+
+		typedef list<Entry> EntryList;
+
+		// Most recently used first
+		EntryList entries;
+		unordered_map<string, EntryList::iterator> urlMap;
+
+		void removeEntry(EntryList::iterator aEntry) noexcept;
+
+		size_t totalSize = 0;
+		const size_t maxSize;
+
+		CriticalSection cs;
+	};
+}
+
+#endif
@@ -0,0 +1,346 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/ProxyDownload.h>
+
+#include <airdcpp/StringTokenizer.h>
+#include <airdcpp/Text.h>
+#include <airdcpp/Util.h>
+
+#include <boost/version.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+
+// beast::tcp_stream and asio::make_strand were added in Boost 1.70
+#if BOOST_VERSION < 107000
+#error "Boost 1.70 or newer is required for proxy downloads"
+#endif
+
+#define PROXY_DOWNLOAD_TIMEOUT 30 // seconds
+#define PROXY_DOWNLOAD_MAX_REDIRECTS 5
+
+namespace webserver {
+	namespace beast = boost::beast;
+	namespace http = boost::beast::http;
+	namespace ssl = boost::asio::ssl;
+	using boost::asio::ip::tcp;
+
+	class ProxyDownloadImpl : public ProxyDownload, public std::enable_shared_from_this<ProxyDownloadImpl> {
+	public:
+		ProxyDownloadImpl(boost::asio::io_service& aIOS, size_t aMaxSize, CompletionF&& aCompletionF) :
+			strand(boost::asio::make_strand(aIOS)), resolver(strand), sslContext(ssl::context::tls_client), maxSize(aMaxSize), completionF(move(aCompletionF)) {
+
+			// The file is served to the browser from the origin of the UI so the remote server must be verified
+			// (unlike with the core HTTP connections)
+			sslContext.set_default_verify_paths();
+			sslContext.set_verify_mode(ssl::verify_peer);
+		}
+
+		void start(const string& aUrl) noexcept override {
+			boost::asio::post(strand, [self = shared_from_this(), aUrl] {
+				self->request(aUrl);
+			});
+		}
+
+		void cancel() noexcept override {
+			boost::asio::post(strand, [self = shared_from_this()] {
+				self->fail("Download cancelled");
+			});
+		}
+	private:
+		typedef beast::ssl_stream<beast::tcp_stream> TlsStream;
+
+		void request(const string& aUrl) noexcept {
+			if (finished) {
+				return;
+			}
+
+			string protocol, port, path, query, fragment;
+			Util::decodeUrl(aUrl, protocol, host, port, path, query, fragment);
+			if (protocol != "http" && protocol != "https") {
+				fail("Unsupported protocol");
+				return;
+			}
+
+			if (port.empty()) {
+				port = protocol == "https" ? "443" : "80";
+			}
+
+			target = path.empty() ? "/" : path;
+			if (!query.empty()) {
+				target += "?" + query;
+			}
+
+			url = aUrl;
+			closeStream();
+			if (protocol == "https") {
+				tls = make_unique<TlsStream>(strand, sslContext);
+
+				// SNI
+				if (!SSL_set_tlsext_host_name(tls->native_handle(), host.c_str())) {
+					fail("Failed to set the TLS host name");
+					return;
+				}
+
+#if BOOST_VERSION >= 107300
+				tls->set_verify_callback(ssl::host_name_verification(host));
+#else
+				tls->set_verify_callback(ssl::rfc2818_verification(host));
+#endif
+			} else {
+				plain = make_unique<beast::tcp_stream>(strand);
+			}
+
+			resolver.async_resolve(host, port, [self = shared_from_this()](const boost::system::error_code& ec, tcp::resolver::results_type aResults) {
+				self->onResolved(ec, aResults);
+			});
+		}
+
+		template<typename F>
+		void withStream(F&& aF) {
+			if (tls) {
+				aF(*tls);
+			} else {
+				aF(*plain);
+			}
+		}
+
+		beast::tcp_stream& getLowestLayer() noexcept {
+			return tls ? beast::get_lowest_layer(*tls) : *plain;
+		}
+
+		void onResolved(const boost::system::error_code& ec, const tcp::resolver::results_type& aResults) noexcept {
+			if (ec) {
+				fail(ec.message());
+				return;
+			}
+
+			if (finished) {
+				return;
+			}
+
+			auto& lowest = getLowestLayer();
+			lowest.expires_after(std::chrono::seconds(PROXY_DOWNLOAD_TIMEOUT));
+			lowest.async_connect(aResults, [self = shared_from_this()](const boost::system::error_code& aError, const tcp::endpoint&) {
+				self->onConnected(aError);
+			});
+		}
+
+		void onConnected(const boost::system::error_code& ec) noexcept {
+			if (ec) {
+				fail(ec.message());
+				return;
+			}
+
+			if (finished) {
+				return;
+			}
+
+			if (tls) {
+				tls->async_handshake(ssl::stream_base::client, [self = shared_from_this()](const boost::system::error_code& aError) {
+					self->onHandshake(aError);
+				});
+			} else {
+				sendRequest();
+			}
+		}
+
+		void onHandshake(const boost::system::error_code& ec) noexcept {
+			if (ec) {
+				fail(ec.message());
+				return;
+			}
+
+			sendRequest();
+		}
+
+		void sendRequest() noexcept {
+			if (finished) {
+				return;
+			}
+
+			req = {};
+			req.version(11);
+			req.method(http::verb::get);
+			req.target(target);
+			req.set(http::field::host, host);
+			req.set(http::field::user_agent, "AirDC++ Web API");
+			req.set(http::field::connection, "close");
+
+			withStream([this](auto& aStream) {
+				http::async_write(aStream, req, [self = shared_from_this()](const boost::system::error_code& ec, size_t) {
+					self->onRequestSent(ec);
+				});
+			});
+		}
+
+		void onRequestSent(const boost::system::error_code& ec) noexcept {
+			if (ec) {
+				fail(ec.message());
+				return;
+			}
+
+			if (finished) {
+				return;
+			}
+
+			// The limit is enforced while the body is being received (a larger Content-Length fails immediately)
+			buffer.clear();
+			parser.emplace();
+			parser->body_limit(maxSize);
+
+			withStream([this](auto& aStream) {
+				http::async_read(aStream, buffer, *parser, [self = shared_from_this()](const boost::system::error_code& aError, size_t) {
+					self->onResponse(aError);
+				});
+			});
+		}
+
+		void onResponse(const boost::system::error_code& ec) noexcept {
+			if (ec == http::error::body_limit) {
+				fail("The remote file is too large");
+				return;
+			}
+
+			if (ec) {
+				fail(ec.message());
+				return;
+			}
+
+			if (finished) {
+				return;
+			}
+
+			auto& res = parser->get();
+			auto status = res.result_int();
+
+			// Redirect?
+			if (status >= 300 && status < 400 && res.find(http::field::location) != res.end()) {
+				if (redirects++ >= PROXY_DOWNLOAD_MAX_REDIRECTS) {
+					fail("Too many redirects");
+					return;
+				}
+
+				auto location = string(res[http::field::location]);
+				if (location.compare(0, 2, "//") == 0) {
+					// Relative to the current protocol
+					location = url.substr(0, url.find("://") + 1) + location;
+				} else if (!location.empty() && location.front() == '/') {
+					// Relative to the current host
+					location = url.substr(0, url.find('/', url.find("://") + 3)) + location;
+				}
+
+				// The current stream is replaced, don't do that from its own completion handler
+				boost::asio::post(strand, [self = shared_from_this(), location] {
+					self->request(location);
+				});
+				return;
+			}
+
+			Result result;
+			result.status = static_cast<int>(status);
+			result.statusText = string(res.reason());
+			result.body = move(res.body());
+
+			auto cacheControl = res.find(http::field::cache_control);
+			if (cacheControl != res.end()) {
+				parseCacheControl(string(cacheControl->value()), result);
+			}
+
+			finish(result);
+		}
+
+		void fail(const string& aError) noexcept {
+			Result result;
+			result.error = aError;
+			finish(result);
+		}
+
+		void finish(const Result& aResult) noexcept {
+			if (finished) {
+				return;
+			}
+
+			finished = true;
+			resolver.cancel();
+			closeStream();
+
+			completionF(aResult);
+		}
+
+		void closeStream() noexcept {
+			if (tls) {
+				beast::get_lowest_layer(*tls).close();
+			} else if (plain) {
+				plain->close();
+			}
+		}
+
+		boost::asio::strand<boost::asio::io_service::executor_type> strand;
+		tcp::resolver resolver;
+		ssl::context sslContext;
+
+		unique_ptr<TlsStream> tls;
+		unique_ptr<beast::tcp_stream> plain;
+
+		beast::flat_buffer buffer;
+		http::request<http::empty_body> req;
+		boost::optional<http::response_parser<http::string_body>> parser;
+
+		string url;
+		string host;
+		string target;
+
+		int redirects = 0;
+		bool finished = false;
+
+		const size_t maxSize;
+		const CompletionF completionF;
+	};
+
+	ProxyDownload::Ptr ProxyDownload::create(boost::asio::io_service& aIOS, size_t aMaxSize, CompletionF&& aCompletionF) noexcept {
+		return make_shared<ProxyDownloadImpl>(aIOS, aMaxSize, move(aCompletionF));
+	}
+
+	void ProxyDownload::parseCacheControl(const string& aValue, Result& result_) noexcept {
+		result_.cacheControl = aValue;
+
+		int64_t maxAge = -1, sharedMaxAge = -1;
+		StringTokenizer<string> directives(Text::toLower(aValue), ',');
+		for (auto directive: directives.getTokens()) {
+			boost::algorithm::trim(directive);
+
+			if (directive == "no-store" || directive == "no-cache" || directive == "private") {
+				result_.storable = false;
+			} else if (directive.compare(0, 8, "max-age=") == 0) {
+				maxAge = Util::toInt64(directive.substr(8));
+			} else if (directive.compare(0, 9, "s-maxage=") == 0) {
+				sharedMaxAge = Util::toInt64(directive.substr(9));
+			}
+		}
+
+		// The cache is shared between all users
+		result_.maxAge = sharedMaxAge >= 0 ? sharedMaxAge : maxAge;
+	}
+}
@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_PROXYDOWNLOAD_H
+#define DCPLUSPLUS_DCPP_PROXYDOWNLOAD_H
+
+#include "stdinc.h"
+
+namespace webserver {
+	// HTTP(S) client for the /proxy handler
+	//
+	// Unlike the core HttpDownload, the response size is limited while the data is being received
+	// and the caching headers of the response are available to the caller
+	//
+	// The body is buffered in memory (up to the maximum size) before the completion handler is called. The response 
+	// is stored in the shared proxy cache and deferred HTTP responses of websocketpp can't be streamed either.
+	// The certificates of HTTPS servers are verified against the default CA paths of the system.
+	class ProxyDownload {
+	public:
+		typedef shared_ptr<ProxyDownload> Ptr;
+
+		struct Result {
+			// Set if the download failed before a response was received
+			string error;
+
+			int status = 0;
+			string statusText;
+			string body;
+
+			// Caching directives of the response
+			string cacheControl;
+
+			// False if the response must not be stored by a shared cache (no-store, no-cache or private)
+			bool storable = true;
+
+			// Freshness lifetime in seconds (s-maxage or max-age), -1 if not specified
+			int64_t maxAge = -1;
+		};
+
+		typedef std::function<void(const Result&)> CompletionF;
+
+		// The completion handler is called from an IO thread
+		static Ptr create(boost::asio::io_service& aIOS, size_t aMaxSize, CompletionF&& aCompletionF) noexcept;
+
+		virtual void start(const string& aUrl) noexcept = 0;
+
+		// The completion handler will be called with an error
+		virtual void cancel() noexcept = 0;
+
+		virtual ~ProxyDownload() { }
+
+		// Parses the value of a Cache-Control header
+		static void parseCacheControl(const string& aValue, Result& result_) noexcept;
+	};
+}
+
+#endif
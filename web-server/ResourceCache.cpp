@@ -0,0 +1,154 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/ResourceCache.h>
+
+#include <airdcpp/Encoder.h>
+#include <airdcpp/File.h>
+#include <airdcpp/TigerHash.h>
+#include <airdcpp/Util.h>
+
+#include <zlib.h>
+
+#define MAX_CACHED_FILE_SIZE 20*1024*1024
+
+namespace webserver {
+	using namespace dcpp;
+
+	ResourceCache::Resource::Ptr ResourceCache::getResource(const string& aPath) {
+		auto modified = getLastModified(aPath);
+
+		{
+			RLock l(cs);
+			auto i = resources.find(aPath);
+			if (i != resources.end() && i->second->modified == modified) {
+				return i->second;
+			}
+		}
+
+		auto resource = loadResource(aPath, modified);
+		if (getTotalSize(*resource) <= MAX_CACHED_FILE_SIZE) {
+			WLock l(cs);
+			resources[aPath] = resource;
+		}
+
+		return resource;
+	}
+
+	void ResourceCache::clear() noexcept {
+		WLock l(cs);
+		resources.clear();
+	}
+
+	ResourceCache::FileTimes ResourceCache::getLastModified(const string& aPath) noexcept {
+		FileTimes ret;
+		ret.plain = max(File::getLastModified(aPath), static_cast<time_t>(0));
+		ret.gzip = max(File::getLastModified(aPath + ".gz"), static_cast<time_t>(0));
+		ret.brotli = max(File::getLastModified(aPath + ".br"), static_cast<time_t>(0));
+		return ret;
+	}
+
+	size_t ResourceCache::getTotalSize(const Resource& aResource) noexcept {
+		return aResource.data.size() + aResource.gzipData.size() + aResource.brotliData.size();
+	}
+
+	ResourceCache::Resource::Ptr ResourceCache::loadResource(const string& aPath, const FileTimes& aModified) {
+		auto resource = make_shared<Resource>();
+		resource->modified = aModified;
+
+		// Use the precompressed files if they exist
+		resource->gzipData = readOptionalFile(aPath + ".gz");
+		resource->brotliData = readOptionalFile(aPath + ".br");
+
+		if (resource->gzipData.empty()) {
+			resource->data = File(aPath, File::READ, File::OPEN).read();
+
+			// Files that are too large to be cached are served uncompressed (they would be compressed again for each request)
+			if (isCompressible(aPath) && getTotalSize(*resource) <= MAX_CACHED_FILE_SIZE) {
+				auto compressed = gzipCompress(resource->data);
+				if (getTotalSize(*resource) + compressed.size() <= MAX_CACHED_FILE_SIZE) {
+					resource->gzipData = move(compressed);
+				}
+			}
+		} else {
+			// The original file is needed only for clients not supporting compression
+			resource->data = readOptionalFile(aPath);
+		}
+
+		resource->eTag = createETag(resource->data);
+		resource->gzipETag = createETag(resource->gzipData);
+		resource->brotliETag = createETag(resource->brotliData);
+		return resource;
+	}
+
+	string ResourceCache::createETag(const string& aData) noexcept {
+		if (aData.empty()) {
+			return Util::emptyString;
+		}
+
+		TigerHash tiger;
+		tiger.update(aData.data(), aData.size());
+		return "\"" + Encoder::toBase32(tiger.finalize(), TigerHash::BYTES) + "\"";
+	}
+
+	bool ResourceCache::isCompressible(const string& aPath) noexcept {
+		static const StringList compressibleTypes = { ".js", ".css", ".html", ".svg", ".json", ".map", ".txt" };
+
+		auto ext = Text::toLower(Util::getFileExt(aPath));
+		return find(compressibleTypes.begin(), compressibleTypes.end(), ext) != compressibleTypes.end();
+	}
+
+	string ResourceCache::readOptionalFile(const string& aPath) noexcept {
+		try {
+			return File(aPath, File::READ, File::OPEN).read();
+		} catch (const FileException&) {
+			return Util::emptyString;
+		}
+	}
+
+	string ResourceCache::gzipCompress(const string& aData) noexcept {
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+
+		// 15 window bits + 16 for the gzip header
+		if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			return Util::emptyString;
+		}
+
+		string ret;
+		ret.resize(deflateBound(&zs, static_cast<uLong>(aData.size())));
+
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(aData.data()));
+		zs.avail_in = static_cast<uInt>(aData.size());
+		zs.next_out = reinterpret_cast<Bytef*>(&ret[0]);
+		zs.avail_out = static_cast<uInt>(ret.size());
+
+		auto result = deflate(&zs, Z_FINISH);
+		ret.resize(zs.total_out);
+		deflateEnd(&zs);
+
+		if (result != Z_STREAM_END || ret.size() >= aData.size()) {
+			// Not worth it
+			return Util::emptyString;
+		}
+
+		return ret;
+	}
+}
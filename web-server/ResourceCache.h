@@ -0,0 +1,81 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_RESOURCECACHE_H
+#define DCPLUSPLUS_DCPP_RESOURCECACHE_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	// In-memory cache for the static web resources (UI files)
+	// Compressed variants and the ETags are created when the file is loaded and the entries
+	// are reloaded when the modification time of the file or any of its precompressed variants changes
+	class ResourceCache {
+	public:
+		// Modification times of the plain file and the precompressed variants (0 if the file doesn't exist)
+		struct FileTimes {
+			time_t plain = 0;
+			time_t gzip = 0;
+			time_t brotli = 0;
+
+			bool operator==(const FileTimes& aOther) const noexcept {
+				return plain == aOther.plain && gzip == aOther.gzip && brotli == aOther.brotli;
+			}
+		};
+
+		struct Resource {
+			typedef shared_ptr<const Resource> Ptr;
+
+			string data;
+
+			// Empty if no compressed variant is available
+			string gzipData;
+			string brotliData;
+
+			// Each encoding is a different representation of the resource
+			string eTag;
+			string gzipETag;
+			string brotliETag;
+
+			FileTimes modified;
+		};
+
+		// Returns the resource, loading it from disk if needed
+		// Throws FileException if the file can't be read
+		Resource::Ptr getResource(const string& aPath);
+		void clear() noexcept;
+	private:
+		static Resource::Ptr loadResource(const string& aPath, const FileTimes& aModified);
+		static FileTimes getLastModified(const string& aPath) noexcept;
+		static size_t getTotalSize(const Resource& aResource) noexcept;
+
+		static bool isCompressible(const string& aPath) noexcept;
+		static string gzipCompress(const string& aData) noexcept;
+		static string readOptionalFile(const string& aPath) noexcept;
+
+		// Returns an empty string for empty data
+		static string createETag(const string& aData) noexcept;
+
+		mutable SharedMutex cs;
+		map<string, Resource::Ptr> resources;
+	};
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "stdinc.h"
 #include <web-server/Session.h>
 #include <web-server/ApiRequest.h>
+#include <web-server/WebServerManager.h>
 
 #include <api/ConnectivityApi.h>
 #include <api/ExtensionApi.h>
@@ -53,7 +54,7 @@ namespace webserver {
 
 	Session::Session(const WebUserPtr& aUser, const string& aToken, SessionType aSessionType, WebServerManager* aServer, uint64_t maxInactivityMinutes, const string& aIP) :
 		id(Util::rand()), user(aUser), token(aToken), started(GET_TICK()), 
-		lastActivity(GET_TICK()), sessionType(aSessionType), server(aServer),
+		lastActivity(GET_TICK()), sessionType(aSessionType), server(aServer), executor(aServer->getTaskService(), aServer->getTaskQueueStats(WebServerManager::PRIORITY_INTERACTIVE)),
 		maxInactivity(maxInactivityMinutes*1000*60),
 		ip(aIP) {
 
@@ -125,6 +126,29 @@ namespace webserver {
 		fire(SessionListener::SocketDisconnected());
 	}
 
+	bool Session::admitRequest(bool aExpensive) noexcept {
+		const auto& limits = server->getApiRateLimits();
+		const auto rate = aExpensive ? limits.expensiveRequestRate : limits.requestRate;
+		if (rate <= 0) {
+			return true;
+		}
+
+		// A request rejected by the user limit must not use the session's tokens
+		const auto burst = max(rate * limits.burstSeconds, 1.0);
+		return (aExpensive ? expensiveRequests : requests).consume(
+			rate, burst, 
+			user->getRequestBucket(aExpensive), rate * limits.userMultiplier, burst * limits.userMultiplier, 
+			GET_TICK()
+		);
+	}
+
+	json Session::getRateLimitStats() const noexcept {
+		return {
+			{ "requests", requests.toJson() },
+			{ "expensive_requests", expensiveRequests.toJson() },
+		};
+	}
+
 	void Session::updateActivity() noexcept {
 		lastActivity = GET_TICK();
 	}
@@ -22,7 +22,9 @@
 #include "stdinc.h"
 
 #include <web-server/LazyInitWrapper.h>
+#include <web-server/SessionExecutor.h>
 #include <web-server/SessionListener.h>
+#include <web-server/TokenBucket.h>
 #include <web-server/WebUser.h>
 
 #include <api/base/ApiModule.h>
@@ -90,7 +92,20 @@ namespace webserver {
 		}
 
 		void reportError(const string& aError) noexcept;
+
+		// Socket messages of this session are run in order
+		SessionExecutor& getExecutor() noexcept {
+			return executor;
+		}
+
+		// Checks the request rate limits of the session and its user
+		// Returns false if the request should be rejected
+		bool admitRequest(bool aExpensive) noexcept;
+		json getRateLimitStats() const noexcept;
 	private:
+		TokenBucket requests;
+		TokenBucket expensiveRequests;
+
 		typedef LazyInitWrapper<ApiModule> LazyModuleWrapper;
 		std::map<std::string , LazyModuleWrapper> apiHandlers;
 
@@ -105,6 +120,7 @@ namespace webserver {
 
 		WebUserPtr user;
 		WebServerManager* server;
+		SessionExecutor executor;
 
 		mutable CriticalSection cs;
 	};
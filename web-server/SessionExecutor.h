@@ -0,0 +1,61 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_SESSIONEXECUTOR_H
+#define DCPLUSPLUS_DCPP_SESSIONEXECUTOR_H
+
+#include "stdinc.h"
+
+#include <web-server/TaskQueueStats.h>
+
+namespace webserver {
+	// Runs the tasks of a single session in order on the shared task pool
+	//
+	// Only one task of the session is being run at a time so that a session performing
+	// expensive operations can't occupy all task threads
+	//
+	// The tasks are also recorded in the statistics of the pool so that the backlog of the sessions 
+	// is included in the queueing delay that is used for tuning the pool
+	class SessionExecutor : boost::noncopyable {
+	public:
+		SessionExecutor(boost::asio::io_service& aIO, TaskQueueStats& aPoolStats) : strand(aIO), poolStats(aPoolStats) {
+
+		}
+
+		// The caller must ensure that the owner (session) won't be deleted before the task has been run
+		void post(CallBack&& aTask) noexcept {
+			auto queued = stats.onTaskQueued();
+			poolStats.onTaskQueued();
+			strand.post([this, aTask = move(aTask), queued] {
+				stats.onTaskStarted(queued);
+				poolStats.onTaskStarted(queued);
+				aTask();
+			});
+		}
+
+		const TaskQueueStats& getStats() const noexcept {
+			return stats;
+		}
+	private:
+		boost::asio::io_service::strand strand;
+		TaskQueueStats stats;
+		TaskQueueStats& poolStats;
+	};
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_SHARDEDMAP_H
+#define DCPLUSPLUS_DCPP_SHARDEDMAP_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	// Hash map that is split into independently locked shards
+	// Lookups and updates only lock the shard of the key so that they don't contend with each other
+	template<typename KeyT, typename ValueT, typename HashT = std::hash<KeyT>, size_t ShardCount = 16>
+	class ShardedMap : boost::noncopyable {
+	public:
+		static_assert((ShardCount & (ShardCount - 1)) == 0, "Shard count must be a power of two");
+
+		// Returns false if the key exists already
+		bool emplace(const KeyT& aKey, const ValueT& aValue) noexcept {
+			auto& shard = getShard(aKey);
+
+			WLock l(shard.cs);
+			return shard.items.emplace(aKey, aValue).second;
+		}
+
+		void set(const KeyT& aKey, const ValueT& aValue) noexcept {
+			auto& shard = getShard(aKey);
+
+			WLock l(shard.cs);
+			shard.items[aKey] = aValue;
+		}
+
+		// Returns a default-constructed value if the key doesn't exist
+		ValueT find(const KeyT& aKey) const noexcept {
+			const auto& shard = getShard(aKey);
+
+			RLock l(shard.cs);
+			auto i = shard.items.find(aKey);
+			return i != shard.items.end() ? i->second : ValueT();
+		}
+
+		// Returns the removed value (or a default-constructed value if the key doesn't exist)
+		ValueT erase(const KeyT& aKey) noexcept {
+			auto& shard = getShard(aKey);
+
+			WLock l(shard.cs);
+			auto i = shard.items.find(aKey);
+			if (i == shard.items.end()) {
+				return ValueT();
+			}
+
+			auto value = std::move(i->second);
+			shard.items.erase(i);
+			return value;
+		}
+
+		// Removes the key only if it's mapped to the given value
+		bool erase(const KeyT& aKey, const ValueT& aValue) noexcept {
+			auto& shard = getShard(aKey);
+
+			WLock l(shard.cs);
+			auto i = shard.items.find(aKey);
+			if (i == shard.items.end() || !(i->second == aValue)) {
+				return false;
+			}
+
+			shard.items.erase(i);
+			return true;
+		}
+
+		// The shards are locked one at a time so the callback sees no consistent snapshot of the whole map
+		// The callback must not modify the map
+		template<typename CallbackT>
+		void forEach(CallbackT&& aCallback) const {
+			for (const auto& shard : shards) {
+				RLock l(shard.cs);
+				for (const auto& item : shard.items) {
+					aCallback(item.second);
+				}
+			}
+		}
+
+		vector<ValueT> values() const noexcept {
+			vector<ValueT> ret;
+			forEach([&ret](const ValueT& aValue) {
+				ret.push_back(aValue);
+			});
+
+			return ret;
+		}
+
+		size_t size() const noexcept {
+			size_t ret = 0;
+			for (const auto& shard : shards) {
+				RLock l(shard.cs);
+				ret += shard.items.size();
+			}
+
+			return ret;
+		}
+
+		bool empty() const noexcept {
+			return size() == 0;
+		}
+
+		// Returns the removed values
+		vector<ValueT> clear() noexcept {
+			vector<ValueT> ret;
+			for (auto& shard : shards) {
+				WLock l(shard.cs);
+				for (auto& item : shard.items) {
+					ret.push_back(std::move(item.second));
+				}
+
+				shard.items.clear();
+			}
+
+			return ret;
+		}
+	private:
+		struct Shard {
+			mutable SharedMutex cs;
+			unordered_map<KeyT, ValueT, HashT> items;
+		};
+
+		// Pointer and integer keys often have identity hashes, mix the bits before selecting the shard
+		static size_t getShardIndex(const KeyT& aKey) noexcept {
+			auto hash = static_cast<uint64_t>(HashT()(aKey));
+			return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ULL) >> 32) & (ShardCount - 1);
+		}
+
+		Shard& getShard(const KeyT& aKey) noexcept {
+			return shards[getShardIndex(aKey)];
+		}
+
+		const Shard& getShard(const KeyT& aKey) const noexcept {
+			return shards[getShardIndex(aKey)];
+		}
+
+		array<Shard, ShardCount> shards;
+	};
+}
+
+#endif
@@ -21,6 +21,10 @@
 
 #include <airdcpp/Text.h>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 namespace webserver {
 	string SystemUtil::getHostname() noexcept {
 #ifdef _WIN32
@@ -48,4 +52,31 @@ namespace webserver {
 		return "other";
 #endif
 	}
-}
\ No newline at end of file
+
+	uint64_t SystemUtil::getProcessCpuTime() noexcept {
+#ifdef _WIN32
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+			return 0;
+		}
+
+		auto toMicroseconds = [](const FILETIME& aTime) {
+			// 100-nanosecond intervals
+			return ((static_cast<uint64_t>(aTime.dwHighDateTime) << 32) | aTime.dwLowDateTime) / 10;
+		};
+
+		return toMicroseconds(kernelTime) + toMicroseconds(userTime);
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+
+		auto toMicroseconds = [](const timeval& aTime) {
+			return static_cast<uint64_t>(aTime.tv_sec) * 1000000 + static_cast<uint64_t>(aTime.tv_usec);
+		};
+
+		return toMicroseconds(usage.ru_utime) + toMicroseconds(usage.ru_stime);
+#endif
+	}
+}
@@ -26,6 +26,9 @@ namespace webserver {
 	public:
 		static string getHostname() noexcept;
 		static string getPlatform() noexcept;
+
+		// User and kernel CPU time used by all threads of the process (microseconds)
+		static uint64_t getProcessCpuTime() noexcept;
 	};
 }
 
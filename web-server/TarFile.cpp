@@ -20,50 +20,283 @@
 #include <web-server/TarFile.h>
 
 #include <airdcpp/Exception.h>
-#include <airdcpp/File.h>
-#include <airdcpp/Text.h>
+#include <airdcpp/StringTokenizer.h>
+#include <airdcpp/Util.h>
 
-#ifdef WIN32
 #include <boost/algorithm/string/replace.hpp>
-#endif
+
+#define TAR_BLOCK_SIZE 512
+#define TAR_MAX_EXTENDED_HEADER 64 * 1024
+
+#define INFLATE_BUF_SIZE 64 * 1024
+#define READ_BUF_SIZE 64 * 1024
 
 namespace webserver {
-	TarFile::TarFile(const string& aPath) {
-		auto res = mtar_open(&tar, Text::fromUtf8(aPath).c_str(), "r");
-		if (res != MTAR_ESUCCESS) {
-			throw Exception(mtar_strerror(res));
+	TarFile::TarFile(const string& aDestPath) : destPath(aDestPath) {
+		memset(&zs, 0, sizeof(zs));
+	}
+
+	TarFile::~TarFile() {
+		if (gzipInitialized) {
+			inflateEnd(&zs);
+		}
+	}
+
+	void TarFile::extractGzipFile(const string& aArchivePath) {
+		File f(aArchivePath, File::READ, File::OPEN, File::BUFFER_SEQUENTIAL);
+
+		boost::scoped_array<char> buf(new char[READ_BUF_SIZE]);
+		for (;;) {
+			size_t len = READ_BUF_SIZE;
+			len = f.read(&buf[0], len);
+			if (len == 0) {
+				break;
+			}
+
+			writeGzip(&buf[0], len);
+		}
+	}
+
+	void TarFile::writeGzip(const void* aData, size_t aLen) {
+		if (!gzipInitialized) {
+			// Detect the gzip header automatically
+			if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+				throw Exception("Failed to initialize the decompressor");
+			}
+
+			gzipInitialized = true;
+		}
+
+		if (gzipEnded) {
+			// Trailing garbage
+			return;
+		}
+
+		char outBuf[INFLATE_BUF_SIZE];
+
+		zs.next_in = (Bytef*)aData;
+		zs.avail_in = static_cast<uInt>(aLen);
+		while (zs.avail_in > 0) {
+			zs.next_out = (Bytef*)outBuf;
+			zs.avail_out = INFLATE_BUF_SIZE;
+
+			auto res = inflate(&zs, Z_NO_FLUSH);
+			if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR) {
+				throw Exception(zs.msg ? string(zs.msg) : "Failed to decompress the archive");
+			}
+
+			write(outBuf, INFLATE_BUF_SIZE - zs.avail_out);
+
+			if (res == Z_STREAM_END) {
+				gzipEnded = true;
+				break;
+			}
 		}
 	}
 
-	void TarFile::extract(const string& aDestPath) {
-		mtar_header_t h;
-		while ((mtar_read_header(&tar, &h)) != MTAR_ENULLRECORD) {
-			if (h.type != MTAR_TDIR && strcmp(h.name, "pax_global_header") != 0) {
-				boost::scoped_array<char> buf(new char[h.size + 1]);
-				auto res = mtar_read_data(&tar, &buf[0], h.size);
-				if (res != MTAR_ESUCCESS) {
-					throw Exception(mtar_strerror(res));
+	void TarFile::write(const char* aData, size_t aLen) {
+		while (aLen > 0) {
+			size_t consumed = 0;
+			switch (state) {
+				case STATE_HEADER: {
+					consumed = min(aLen, sizeof(header) - headerPos);
+					memcpy(header + headerPos, aData, consumed);
+					headerPos += consumed;
+					if (headerPos == sizeof(header)) {
+						headerPos = 0;
+						onHeader();
+					}
+					break;
+				}
+				case STATE_DATA: {
+					consumed = static_cast<size_t>(min(static_cast<int64_t>(aLen), entryRemaining));
+					onData(aData, consumed);
+					entryRemaining -= consumed;
+					if (entryRemaining == 0) {
+						onEntryCompleted();
+					}
+					break;
 				}
+				case STATE_PADDING: {
+					consumed = static_cast<size_t>(min(static_cast<int64_t>(aLen), paddingRemaining));
+					paddingRemaining -= consumed;
+					if (paddingRemaining == 0) {
+						state = STATE_HEADER;
+					}
+					break;
+				}
+				case STATE_END: {
+					// Ignore the rest of the end-of-archive blocks
+					return;
+				}
+			}
 
-				string destFile = aDestPath + h.name;
+			aData += consumed;
+			aLen -= consumed;
+		}
+	}
 
-#ifdef WIN32
-				// Wrong path separators would hit assertions...
-				boost::replace_all(destFile, "/", PATH_SEPARATOR_STR);
-#endif
+	void TarFile::finish() {
+		if (gzipInitialized && !gzipEnded) {
+			throw Exception("Unexpected end of the compressed archive");
+		}
+
+		if (state == STATE_DATA || headerPos > 0) {
+			throw Exception("Unexpected end of the archive");
+		}
+	}
+
+	static int64_t parseOctal(const char* aData, size_t aLen) {
+		int64_t ret = 0;
+		for (size_t i = 0; i < aLen && aData[i] != '\0' && aData[i] != ' '; i++) {
+			if (aData[i] < '0' || aData[i] > '7') {
+				throw Exception("Invalid number field in the archive");
+			}
+
+			ret = (ret << 3) + (aData[i] - '0');
+		}
+
+		return ret;
+	}
+
+	void TarFile::onHeader() {
+		if (all_of(begin(header), end(header), [](char c) { return c == '\0'; })) {
+			state = STATE_END;
+			return;
+		}
+
+		// Checksum is calculated with the checksum field filled with spaces
+		int64_t checksum = 0;
+		for (size_t i = 0; i < sizeof(header); i++) {
+			checksum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(header[i]);
+		}
+
+		if (checksum != parseOctal(header + 148, 8)) {
+			throw Exception("Invalid checksum in the archive");
+		}
+
+		entryType = header[156];
+		entryRemaining = parseOctal(header + 124, 12);
+		paddingRemaining = (TAR_BLOCK_SIZE - entryRemaining % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+		longName = move(nextLongName);
+		nextLongName.clear();
+
+		switch (entryType) {
+			case '0':
+			case '\0':
+			case '7': {
+				// Regular file
+				auto destFile = destPath + parseEntryName();
 
 				File::ensureDirectory(destFile);
-				{
-					File f(destFile, File::WRITE, File::OPEN | File::CREATE | File::TRUNCATE, File::BUFFER_SEQUENTIAL);
-					f.write(&buf[0], h.size);
+				entryFile = make_unique<File>(destFile, File::WRITE, File::OPEN | File::CREATE | File::TRUNCATE, File::BUFFER_SEQUENTIAL);
+				break;
+			}
+			case '5': {
+				File::ensureDirectory(destPath + parseEntryName() + PATH_SEPARATOR);
+				break;
+			}
+			case 'L':
+			case 'x': {
+				// Name for the next entry
+				if (entryRemaining > TAR_MAX_EXTENDED_HEADER) {
+					throw Exception("Extended header in the archive is too long");
 				}
+				break;
+			}
+			default: {
+				// Links, PAX headers etc. aren't extracted
+				break;
 			}
+		}
 
-			mtar_next(&tar);
+		if (entryRemaining == 0) {
+			onEntryCompleted();
+		} else {
+			state = STATE_DATA;
 		}
 	}
 
-	TarFile::~TarFile() {
-		mtar_close(&tar);
+	void TarFile::onData(const char* aData, size_t aLen) {
+		if (entryFile) {
+			entryFile->write(aData, aLen);
+		} else if (entryType == 'L' || entryType == 'x') {
+			nextLongName.append(aData, aLen);
+		}
+	}
+
+	void TarFile::onEntryCompleted() {
+		entryFile.reset();
+
+		if (entryType == 'L') {
+			// Null-terminated
+			nextLongName = nextLongName.c_str();
+		} else if (entryType == 'x') {
+			nextLongName = parsePaxPath(nextLongName);
+		}
+
+		state = paddingRemaining > 0 ? STATE_PADDING : STATE_HEADER;
+	}
+
+	string TarFile::parsePaxPath(const string& aRecords) {
+		// Records are in format "<length> <key>=<value>\n"
+		string::size_type pos = 0;
+		while (pos < aRecords.size()) {
+			auto space = aRecords.find(' ', pos);
+			if (space == string::npos) {
+				break;
+			}
+
+			auto len = Util::toInt(aRecords.substr(pos, space - pos));
+			if (len <= 0 || pos + len > aRecords.size()) {
+				throw Exception("Invalid extended header in the archive");
+			}
+
+			auto record = aRecords.substr(space + 1, pos + len - space - 2);
+			if (record.compare(0, 5, "path=") == 0) {
+				return record.substr(5);
+			}
+
+			pos += len;
+		}
+
+		return Util::emptyString;
+	}
+
+	string TarFile::parseEntryName() const {
+		string name;
+		if (!longName.empty()) {
+			name = longName;
+		} else {
+			name = string(header, strnlen(header, 100));
+
+			// UStar prefix
+			if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+				name = string(header + 345, strnlen(header + 345, 155)) + "/" + name;
+			}
+		}
+
+		// Backslashes are separators on Windows, check them the same way everywhere
+		boost::replace_all(name, "\\", "/");
+
+		// Don't allow writing outside the destination directory
+		if (name.empty() || name.front() == '/' || name.find(':') != string::npos) {
+			throw Exception("Invalid entry path in the archive: " + name);
+		}
+
+		StringTokenizer<string> components(name, '/');
+		for (const auto& component: components.getTokens()) {
+			if (component == "..") {
+				throw Exception("Invalid entry path in the archive: " + name);
+			}
+		}
+
+#ifdef WIN32
+		// Wrong path separators would hit assertions...
+		boost::replace_all(name, "/", PATH_SEPARATOR_STR);
+#endif
+
+		return name;
 	}
-}
\ No newline at end of file
+}
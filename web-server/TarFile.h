@@ -21,17 +21,69 @@
 
 #include "stdinc.h"
 
-#include <microtar/microtar.h>
+#include <airdcpp/File.h>
+
+#include <zlib.h>
 
 namespace webserver {
+	// Streaming extractor for (gzipped) tar archives
+	// Entries are written on disk as the data arrives so that the whole archive is never kept in memory
+	// Throws Exception/FileException on errors
 	class TarFile {
 	public:
-		TarFile(const string& aPath);
+		TarFile(const string& aDestPath);
 		~TarFile();
 
-		void extract(const string& aDestPath);
+		// Feed gzip compressed archive data
+		void writeGzip(const void* aData, size_t aLen);
+
+		// Feed uncompressed archive data
+		void write(const char* aData, size_t aLen);
+
+		// Reads the whole gzip compressed archive from disk
+		void extractGzipFile(const string& aArchivePath);
+
+		// Throws if the archive is incomplete
+		void finish();
+
+		TarFile(TarFile&) = delete;
+		TarFile& operator=(TarFile&) = delete;
 	private:
-		mtar_t tar;
+		enum State {
+			STATE_HEADER,
+			STATE_DATA,
+			STATE_PADDING,
+			STATE_END
+		};
+
+		void onHeader();
+		void onData(const char* aData, size_t aLen);
+		void onEntryCompleted();
+
+		string parseEntryName() const;
+		static string parsePaxPath(const string& aRecords);
+
+		const string destPath;
+
+		State state = STATE_HEADER;
+
+		char header[512];
+		size_t headerPos = 0;
+
+		char entryType = 0;
+		int64_t entryRemaining = 0;
+		int64_t paddingRemaining = 0;
+
+		// Entry file that is being written
+		unique_ptr<File> entryFile;
+
+		// GNU long name or PAX path for the next entry
+		string longName;
+		string nextLongName;
+
+		z_stream zs;
+		bool gzipInitialized = false;
+		bool gzipEnded = false;
 	};
 }
 
@@ -0,0 +1,168 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/TaskPool.h>
+
+#include <airdcpp/TimerManager.h>
+#include <airdcpp/Util.h>
+
+// Grow the pool if tasks have to wait longer than this on average
+#define GROW_WAIT_TIME_MS 20
+
+// Shrink the pool after it has been idle for this many tuning rounds
+#define SHRINK_IDLE_ROUNDS 12
+
+#define MAX_CPU_USAGE 0.9
+#define MAX_RESIZE_EVENTS 20
+
+namespace webserver {
+	void TaskPool::start(int aMinThreads, int aMaxThreads) noexcept {
+		minThreads = aMinThreads;
+		maxThreads = max(aMinThreads, aMaxThreads);
+
+		lastExecutedTasks = stats.getExecutedTasks();
+		lastWaitTimeTotal = stats.getWaitTimeTotal();
+		idleRounds = 0;
+
+		resize(minThreads, "startup");
+	}
+
+	void TaskPool::join() noexcept {
+		decltype(threads) stoppedThreads;
+
+		{
+			Lock l(cs);
+			stoppedThreads.swap(threads);
+		}
+
+		for (const auto& t: stoppedThreads) {
+			t->join();
+		}
+
+		targetThreadCount = 0;
+		pendingRetires = 0;
+	}
+
+	void TaskPool::run() noexcept {
+		try {
+			ios.run();
+		} catch (const RetireThread&) {
+			// Pool was shrunk
+		}
+	}
+
+	void TaskPool::removeFinishedThreads() noexcept {
+		threads.erase(remove_if(threads.begin(), threads.end(), [](const unique_ptr<boost::thread>& aThread) {
+			return aThread->try_join_for(boost::chrono::milliseconds(0));
+		}), threads.end());
+	}
+
+	void TaskPool::resize(int aThreadCount, const string& aReason) noexcept {
+		aThreadCount = max(min(aThreadCount, maxThreads), minThreads);
+
+		Lock l(cs);
+		removeFinishedThreads();
+
+		int current = targetThreadCount;
+		if (aThreadCount == current) {
+			return;
+		}
+
+		if (aThreadCount > current) {
+			for (int i = current; i < aThreadCount; i++) {
+				threads.push_back(make_unique<boost::thread>([this] { run(); }));
+			}
+		} else {
+			// The next idle threads will exit
+			for (int i = aThreadCount; i < current; i++) {
+				pendingRetires++;
+				ios.post([this] {
+					if (pendingRetires.fetch_sub(1) > 0) {
+						throw RetireThread();
+					}
+
+					pendingRetires++;
+				});
+			}
+		}
+
+		targetThreadCount = aThreadCount;
+		dcdebug("Task pool %s resized from %d to %d threads (%s)\n", name.c_str(), current, aThreadCount, aReason.c_str());
+
+		resizeEvents.push_back({ GET_TIME(), current, aThreadCount, aReason });
+		if (resizeEvents.size() > MAX_RESIZE_EVENTS) {
+			resizeEvents.pop_front();
+		}
+	}
+
+	void TaskPool::tune(double aCpuUsage) noexcept {
+		auto executedTasks = stats.getExecutedTasks();
+		auto waitTimeTotal = stats.getWaitTimeTotal();
+
+		auto executedDelta = executedTasks - lastExecutedTasks;
+		auto averageWaitMs = executedDelta == 0 ? 0 : (waitTimeTotal - lastWaitTimeTotal) / executedDelta / 1000000;
+
+		lastExecutedTasks = executedTasks;
+		lastWaitTimeTotal = waitTimeTotal;
+
+		const int threadCount = targetThreadCount;
+		const auto queueSize = stats.getQueueSize();
+
+		if ((averageWaitMs >= GROW_WAIT_TIME_MS || queueSize > static_cast<size_t>(threadCount)) && threadCount < maxThreads) {
+			idleRounds = 0;
+
+			// More threads won't help if the CPU is the bottleneck
+			if (aCpuUsage < MAX_CPU_USAGE) {
+				resize(threadCount + 1, "average queue time " + Util::toString(averageWaitMs) + " ms, " + Util::toString(queueSize) + " queued tasks");
+			}
+		} else if (averageWaitMs == 0 && queueSize == 0 && threadCount > minThreads) {
+			idleRounds++;
+			if (idleRounds >= SHRINK_IDLE_ROUNDS) {
+				idleRounds = 0;
+				resize(threadCount - 1, "idle");
+			}
+		} else {
+			idleRounds = 0;
+		}
+	}
+
+	json TaskPool::toJson() const noexcept {
+		json events = json::array();
+
+		{
+			Lock l(cs);
+			for (const auto& e: resizeEvents) {
+				events.push_back({
+					{ "time", e.time },
+					{ "from", e.from },
+					{ "to", e.to },
+					{ "reason", e.reason },
+				});
+			}
+		}
+
+		return {
+			{ "threads", getThreadCount() },
+			{ "min_threads", minThreads },
+			{ "max_threads", maxThreads },
+			{ "resize_events", events },
+		};
+	}
+}
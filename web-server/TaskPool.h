@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_TASKPOOL_H
+#define DCPLUSPLUS_DCPP_TASKPOOL_H
+
+#include "stdinc.h"
+
+#include <web-server/TaskQueueStats.h>
+
+#include <airdcpp/CriticalSection.h>
+
+#include <boost/thread/thread.hpp>
+
+namespace webserver {
+	// Thread pool for an io_service that adjusts its size based on the measured queueing delay
+	class TaskPool {
+	public:
+		TaskPool(const string& aName, boost::asio::io_service& aIO, const TaskQueueStats& aStats) : name(aName), ios(aIO), stats(aStats) { }
+
+		void start(int aMinThreads, int aMaxThreads) noexcept;
+
+		// The io_service must have been stopped before calling this
+		void join() noexcept;
+
+		// Should be called periodically
+		// aCpuUsage is the CPU usage of the process since the previous call (0...1)
+		void tune(double aCpuUsage) noexcept;
+
+		void resize(int aThreadCount, const string& aReason) noexcept;
+
+		int getThreadCount() const noexcept {
+			return targetThreadCount;
+		}
+
+		json toJson() const noexcept;
+
+		TaskPool(TaskPool&) = delete;
+		TaskPool& operator=(TaskPool&) = delete;
+	private:
+		struct ResizeEvent {
+			time_t time;
+			int from;
+			int to;
+			string reason;
+		};
+
+		// Thrown from a task to stop the thread running it
+		struct RetireThread { };
+
+		void run() noexcept;
+		void removeFinishedThreads() noexcept;
+
+		const string name;
+		boost::asio::io_service& ios;
+		const TaskQueueStats& stats;
+
+		int minThreads = 1;
+		int maxThreads = 1;
+		atomic<int> targetThreadCount { 0 };
+
+		// Retire tasks that haven't been run yet (they must not affect a restarted pool)
+		atomic<int> pendingRetires { 0 };
+
+		// Used for calculating the wait times since the previous tuning
+		uint64_t lastExecutedTasks = 0;
+		uint64_t lastWaitTimeTotal = 0;
+		int idleRounds = 0;
+
+		deque<ResizeEvent> resizeEvents;
+		vector<unique_ptr<boost::thread>> threads;
+
+		mutable CriticalSection cs;
+	};
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_TASKQUEUESTATS_H
+#define DCPLUSPLUS_DCPP_TASKQUEUESTATS_H
+
+#include "stdinc.h"
+
+#include <web-server/LatencyHistogram.h>
+
+namespace webserver {
+	// Queue size and queueing delay of tasks posted to an executor
+	class TaskQueueStats : boost::noncopyable {
+	public:
+		typedef std::chrono::steady_clock::time_point TimePoint;
+
+		// Returns the queue time that should be passed to onTaskStarted
+		TimePoint onTaskQueued() noexcept {
+			queueSize++;
+			return std::chrono::steady_clock::now();
+		}
+
+		void onTaskStarted(const TimePoint& aQueued) noexcept {
+			auto waitDuration = std::chrono::steady_clock::now() - aQueued;
+			auto waitTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(waitDuration).count());
+			waitTimes.add(waitDuration);
+
+			queueSize--;
+			executedTasks++;
+			waitTimeTotal += waitTime;
+
+			auto curMax = waitTimeMax.load();
+			while (waitTime > curMax && !waitTimeMax.compare_exchange_weak(curMax, waitTime)) {
+				// Another thread updated the value, retry
+			}
+		}
+
+		size_t getQueueSize() const noexcept {
+			return queueSize;
+		}
+
+		uint64_t getExecutedTasks() const noexcept {
+			return executedTasks;
+		}
+
+		// Nanoseconds
+		uint64_t getWaitTimeTotal() const noexcept {
+			return waitTimeTotal;
+		}
+
+		const LatencyHistogram& getWaitTimes() const noexcept {
+			return waitTimes;
+		}
+
+		json toJson() const noexcept {
+			auto count = executedTasks.load();
+			return {
+				{ "queue_size", queueSize.load() },
+				{ "executed_tasks", count },
+				{ "wait_time_average_ns", count == 0 ? 0 : waitTimeTotal.load() / count },
+				{ "wait_time_max_ns", waitTimeMax.load() },
+				{ "wait_time_histogram", waitTimes.toJson() },
+			};
+		}
+	private:
+		atomic<size_t> queueSize { 0 };
+		atomic<uint64_t> executedTasks { 0 };
+		atomic<uint64_t> waitTimeTotal { 0 };
+		atomic<uint64_t> waitTimeMax { 0 };
+
+		LatencyHistogram waitTimes;
+	};
+}
+
+#endif
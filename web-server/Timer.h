@@ -21,6 +21,9 @@
 
 #include "stdinc.h"
 
+#include <web-server/LatencyHistogram.h>
+#include <web-server/TimerWheel.h>
+
 namespace webserver {
 	class Timer : boost::noncopyable {
 	public:
@@ -28,11 +31,13 @@ namespace webserver {
 
 		// CallbackWrapper is meant to ensure the lifetime of the timer
 		// (which necessary only if the timer is called from a class that can be deleted, such as sessions)
-		Timer(CallBack&& aCallBack, boost::asio::io_service& aIO, time_t aIntervalMillis, const CallbackWrapper& aWrapper) : 
+		// aLagStats will receive the delay between the scheduled and the actual execution time of each tick
+		Timer(CallBack&& aCallBack, TimerWheel& aWheel, time_t aIntervalMillis, const CallbackWrapper& aWrapper, LatencyHistogram* aLagStats = nullptr) : 
 			cb(move(aCallBack)),
+			wheel(aWheel),
+			entry(make_shared<TimerWheel::Entry>([cbWrapper = aWrapper, timer = this] { tick(cbWrapper, timer); })),
 			interval(aIntervalMillis),
-			timer(aIO),
-			cbWrapper(aWrapper)
+			lagStats(aLagStats)
 		{
 
 		}
@@ -47,7 +52,7 @@ namespace webserver {
 			}
 
 			running = true;
-			scheduleNext(aInstantTick ? boost::posix_time::milliseconds(0) : interval);
+			scheduleNext(aInstantTick ? 0 : interval);
 			return true;
 		}
 
@@ -55,49 +60,54 @@ namespace webserver {
 		void stop(bool aShutdown) noexcept {
 			running = false;
 			shutdown = aShutdown;
-			timer.cancel();
+			wheel.cancel(entry);
 		}
 
 		bool isRunning() const noexcept {
 			return running;
 		}
 	private:
-		// Static in case the timer has been destructed
-		static void tick(const boost::system::error_code& error, const CallbackWrapper& cbWrapper, Timer* aTimer) {
-			if (error == boost::asio::error::operation_aborted) {
-				return;
-			}
-
-			if (cbWrapper) {
+		// Static in case the timer has been destructed (the wrapper is copied in the entry callback)
+		// The wheel won't call this after the timer has been stopped but the timer may be deleted concurrently
+		static void tick(const CallbackWrapper& aWrapper, Timer* aTimer) {
+			if (aWrapper) {
 				// We must ensure that the timer still exists when a new start call is performed
-				cbWrapper(bind(&Timer::runTask, aTimer));
+				aWrapper(bind(&Timer::runTask, aTimer));
 			} else {
 				aTimer->runTask();
 			}
 		}
 
-		void scheduleNext(const boost::posix_time::milliseconds& aFromNow) {
+		void scheduleNext(uint64_t aFromNow) {
 			if (!running) {
 				return;
 			}
 
-			timer.expires_from_now(aFromNow);
-			timer.async_wait(std::bind(&Timer::tick, std::placeholders::_1, cbWrapper, this));
+			// Timers with the same interval are aligned to expire with the same wakeup
+			wheel.schedule(entry, aFromNow, interval);
 		}
 
 		void runTask() {
+			if (lagStats) {
+				auto now = TimerWheel::now();
+				auto expiresAt = entry->getExpiresAt();
+				lagStats->add(now > expiresAt ? (now - expiresAt) * 1000 : 0);
+			}
+
 			cb();
 
 			scheduleNext(interval);
 		}
 
 		CallBack cb;
-		CallbackWrapper cbWrapper;
 
-		boost::asio::deadline_timer timer;
-		boost::posix_time::milliseconds interval;
+		TimerWheel& wheel;
+		const TimerWheel::EntryPtr entry;
+		const uint64_t interval;
 		bool running = false;
 		bool shutdown = false;
+
+		LatencyHistogram* lagStats;
 	};
 
 	typedef shared_ptr<Timer> TimerPtr;
@@ -0,0 +1,167 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include "stdinc.h"
+
+#include <web-server/TimerWheel.h>
+
+#define WHEEL_RESOLUTION 50 // ms
+#define WHEEL_SIZE 256 // slots (one round is 12.8 seconds)
+
+namespace webserver {
+	TimerWheel::TimerWheel(boost::asio::io_service& aIO) : slots(WHEEL_SIZE), currentTick(now() / WHEEL_RESOLUTION), ios(aIO), timer(aIO) {
+
+	}
+
+	uint64_t TimerWheel::now() noexcept {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	void TimerWheel::schedule(const EntryPtr& aEntry, uint64_t aDelayMillis, uint64_t aAlignMillis) noexcept {
+		auto expiresAt = now() + aDelayMillis;
+		if (aAlignMillis > 0 && aDelayMillis > 0) {
+			// Nearest multiple so that the interval between repeated expirations stays the same
+			auto aligned = ((expiresAt + aAlignMillis / 2) / aAlignMillis) * aAlignMillis;
+			if (aligned > now()) {
+				expiresAt = aligned;
+			}
+		}
+
+		Lock l(cs);
+		aEntry->expiresAt = expiresAt;
+
+		// Round up so that the entry never expires too early
+		auto tick = max((expiresAt + WHEEL_RESOLUTION - 1) / WHEEL_RESOLUTION, currentTick + 1);
+		slots[tick % WHEEL_SIZE].push_back({ aEntry, ++aEntry->generation, tick });
+		itemCount++;
+
+		if (armedTick == 0 || tick < armedTick) {
+			armTimer();
+		}
+	}
+
+	void TimerWheel::cancel(const EntryPtr& aEntry) noexcept {
+		aEntry->generation++;
+	}
+
+	void TimerWheel::stop() noexcept {
+		Lock l(cs);
+		for (auto& slot : slots) {
+			for (const auto& item : slot) {
+				item.entry->generation++;
+			}
+
+			slot.clear();
+		}
+
+		itemCount = 0;
+		armedTick = 0;
+
+		boost::system::error_code ec;
+		timer.cancel(ec);
+	}
+
+	void TimerWheel::armTimer() noexcept {
+		// Find the next slot with items (entries expiring in later rounds are checked at least once per round)
+		auto tick = currentTick + 1;
+		for (; tick < currentTick + WHEEL_SIZE; ++tick) {
+			if (!slots[tick % WHEEL_SIZE].empty()) {
+				break;
+			}
+		}
+
+		armedTick = tick;
+		timer.expires_at(std::chrono::steady_clock::time_point(std::chrono::milliseconds(tick * WHEEL_RESOLUTION)));
+		timer.async_wait([this](const boost::system::error_code& aError) {
+			onTimer(aError);
+		});
+	}
+
+	void TimerWheel::onTimer(const boost::system::error_code& aError) noexcept {
+		if (aError == boost::asio::error::operation_aborted) {
+			return;
+		}
+
+		vector<SlotItem> expiredItems;
+
+		{
+			Lock l(cs);
+			wakeups++;
+
+			auto tick = now() / WHEEL_RESOLUTION;
+			if (tick <= currentTick) {
+				// Woken up too early
+				armTimer();
+				return;
+			}
+
+			// Process each slot at most once even if we have fallen behind for more than a round
+			auto from = max(currentTick + 1, tick >= WHEEL_SIZE ? tick - WHEEL_SIZE + 1 : 0);
+			for (auto t = from; t <= tick; ++t) {
+				auto& slot = slots[t % WHEEL_SIZE];
+				for (size_t i = 0; i < slot.size();) {
+					auto& item = slot[i];
+
+					// Cancelled or rescheduled entries are dropped
+					auto stale = item.generation != item.entry->generation;
+					if (!stale && item.tick > tick) {
+						// Later round
+						++i;
+						continue;
+					}
+
+					if (!stale) {
+						expiredItems.push_back(item);
+					}
+
+					// The order of items within a slot doesn't matter
+					std::swap(item, slot.back());
+					slot.pop_back();
+					itemCount--;
+				}
+			}
+
+			currentTick = tick;
+			expired += expiredItems.size();
+
+			if (itemCount > 0) {
+				armTimer();
+			} else {
+				armedTick = 0;
+			}
+		}
+
+		for (auto& item : expiredItems) {
+			ios.post([item] {
+				// Skip if the entry was cancelled after expiring
+				if (item.generation == item.entry->generation) {
+					item.entry->callback();
+				}
+			});
+		}
+	}
+
+	json TimerWheel::toJson() const noexcept {
+		Lock l(cs);
+		return {
+			{ "scheduled", itemCount },
+			{ "wakeups", wakeups },
+			{ "expired", expired },
+		};
+	}
+}
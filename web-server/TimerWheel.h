@@ -0,0 +1,99 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_TIMERWHEEL_H
+#define DCPLUSPLUS_DCPP_TIMERWHEEL_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+#include <boost/asio/steady_timer.hpp>
+
+namespace webserver {
+	// Hashed timing wheel that drives all periodic timers with a single asio timer
+	// Entries expiring during the same wheel tick are handled with one wakeup and the expired 
+	// callbacks are posted to the io service so that they may still run concurrently
+	class TimerWheel : boost::noncopyable {
+	public:
+		class Entry : boost::noncopyable {
+		public:
+			Entry(CallBack&& aCallBack) : callback(std::move(aCallBack)) { }
+
+			// Steady clock milliseconds
+			uint64_t getExpiresAt() const noexcept {
+				return expiresAt;
+			}
+		private:
+			friend class TimerWheel;
+
+			const CallBack callback;
+			atomic<uint64_t> expiresAt { 0 };
+
+			// Incremented when the entry is scheduled or cancelled, stale slot items are dropped lazily
+			atomic<uint64_t> generation { 0 };
+		};
+
+		typedef shared_ptr<Entry> EntryPtr;
+
+		TimerWheel(boost::asio::io_service& aIO);
+
+		// The expiration time is rounded to the wheel resolution
+		// With aAlignMillis, the expiration is aligned to a multiple of it so that entries with the same interval expire together
+		void schedule(const EntryPtr& aEntry, uint64_t aDelayMillis, uint64_t aAlignMillis = 0) noexcept;
+		void cancel(const EntryPtr& aEntry) noexcept;
+
+		// Cancels all entries
+		void stop() noexcept;
+
+		json toJson() const noexcept;
+
+		// Steady clock milliseconds
+		static uint64_t now() noexcept;
+	private:
+		struct SlotItem {
+			EntryPtr entry;
+			uint64_t generation;
+			uint64_t tick;
+		};
+
+		void onTimer(const boost::system::error_code& aError) noexcept;
+
+		// Arms the asio timer for the next wheel tick containing items
+		void armTimer() noexcept;
+
+		mutable CriticalSection cs;
+
+		vector<vector<SlotItem>> slots;
+		size_t itemCount = 0;
+
+		// Last processed tick
+		uint64_t currentTick;
+
+		// Tick for which the asio timer is armed (0 if not armed)
+		uint64_t armedTick = 0;
+
+		uint64_t wakeups = 0;
+		uint64_t expired = 0;
+
+		boost::asio::io_service& ios;
+		boost::asio::steady_timer timer;
+	};
+}
+
+#endif
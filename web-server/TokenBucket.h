@@ -0,0 +1,107 @@
+/*
+* Copyright (C) 2011-2019 AirDC++ Project
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DCPLUSPLUS_DCPP_TOKENBUCKET_H
+#define DCPLUSPLUS_DCPP_TOKENBUCKET_H
+
+#include "stdinc.h"
+
+#include <airdcpp/CriticalSection.h>
+
+namespace webserver {
+	// Rate limiter allowing bursts up to the bucket size
+	// Tokens are refilled continuously, the limits are passed on each call so that config changes apply immediately
+	class TokenBucket : boost::noncopyable {
+	public:
+		// Returns false if the bucket is empty
+		bool consume(double aRatePerSecond, double aBurst, uint64_t aTick) noexcept {
+			{
+				Lock l(cs);
+				refill(aRatePerSecond, aBurst, aTick);
+
+				if (tokens >= 1) {
+					tokens -= 1;
+					allowed++;
+					return true;
+				}
+			}
+
+			rejected++;
+			return false;
+		}
+
+		// Takes a token from both this bucket and the shared parent bucket, or from neither of them
+		// Rejections caused by the parent are also counted in this bucket
+		// Returns false if either bucket is empty
+		bool consume(double aRatePerSecond, double aBurst, TokenBucket& aParent, double aParentRatePerSecond, double aParentBurst, uint64_t aTick) noexcept {
+			{
+				// Parent buckets are always locked after the child
+				Lock l(cs);
+				Lock pl(aParent.cs);
+
+				refill(aRatePerSecond, aBurst, aTick);
+				aParent.refill(aParentRatePerSecond, aParentBurst, aTick);
+
+				if (tokens >= 1 && aParent.tokens >= 1) {
+					tokens -= 1;
+					aParent.tokens -= 1;
+					allowed++;
+					aParent.allowed++;
+					return true;
+				}
+
+				if (aParent.tokens < 1) {
+					aParent.rejected++;
+				}
+			}
+
+			rejected++;
+			return false;
+		}
+
+		uint64_t getAllowed() const noexcept {
+			return allowed;
+		}
+
+		uint64_t getRejected() const noexcept {
+			return rejected;
+		}
+
+		json toJson() const noexcept {
+			return {
+				{ "allowed", allowed.load() },
+				{ "rejected", rejected.load() },
+			};
+		}
+	private:
+		// The lock must be held
+		void refill(double aRatePerSecond, double aBurst, uint64_t aTick) noexcept {
+			tokens = lastTick == 0 ? aBurst : min(aBurst, tokens + static_cast<double>(aTick - lastTick) * aRatePerSecond / 1000.0);
+			lastTick = aTick;
+		}
+
+		mutable CriticalSection cs;
+		double tokens = 0;
+		uint64_t lastTick = 0;
+
+		atomic<uint64_t> allowed { 0 };
+		atomic<uint64_t> rejected { 0 };
+	};
+}
+
+#endif
@@ -29,11 +29,17 @@
 
 #include <airdcpp/AirUtil.h>
 #include <airdcpp/CryptoManager.h>
+#include <airdcpp/File.h>
 #include <airdcpp/LogManager.h>
 #include <airdcpp/SettingsManager.h>
 #include <airdcpp/SimpleXML.h>
 #include <airdcpp/TimerManager.h>
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define CONFIG_NAME "WebServer.xml"
 #define CONFIG_DIR Util::PATH_USER_CONFIG
 
@@ -41,18 +47,50 @@
 
 #define HANDSHAKE_TIMEOUT 0 // disabled, affects HTTP downloads
 
+// Delay before accepting local socket connections again after an error
+#define UNIX_ACCEPT_RETRY_MS 1000
+
+// Task pools are resized between these limits based on the queueing delay
+#define TASK_POOL_MIN_THREADS std::max(WEBCFG(SERVER_THREADS).num() / 2, 1)
+#define TASK_POOL_MAX_THREADS std::max(WEBCFG(SERVER_THREADS).num() * 2, 4)
+#define TASK_POOL_TUNE_INTERVAL 5 // seconds
+
+#define UNIX_SOCKET_NAME "web-server.sock"
+
+// Default API request limits per session (the expensive limit applies to other than GET requests)
+#define API_REQUEST_RATE 100 // per second
+#define API_EXPENSIVE_REQUEST_RATE 25 // per second
+#define API_RATE_BURST_SECONDS 5
+#define API_USER_RATE_MULTIPLIER 3
+
 namespace webserver {
 	using namespace dcpp;
 	WebServerManager::WebServerManager() : 
 		ios(settings.getValue(WebServerSettings::SERVER_THREADS).getDefaultValue()),
 		tasks(settings.getValue(WebServerSettings::SERVER_THREADS).getDefaultValue()),
 		work(tasks),
+		backgroundTasks(settings.getValue(WebServerSettings::SERVER_THREADS).getDefaultValue()),
+		backgroundWork(backgroundTasks),
 		plainServerConfig(settings.getValue(WebServerSettings::PLAIN_PORT), settings.getValue(WebServerSettings::PLAIN_BIND)),
-		tlsServerConfig(settings.getValue(WebServerSettings::TLS_PORT), settings.getValue(WebServerSettings::TLS_BIND))
+		tlsServerConfig(settings.getValue(WebServerSettings::TLS_PORT), settings.getValue(WebServerSettings::TLS_BIND)),
+		metrics(this),
+		timerWheel(backgroundTasks),
+		taskPoolTimer(ios),
+		taskPool("interactive", tasks, interactiveTaskStats),
+		backgroundTaskPool("background", backgroundTasks, backgroundTaskStats)
 	{
 
 		fileServer.setResourcePath(Util::getPath(Util::PATH_RESOURCES) + "web-resources" + PATH_SEPARATOR);
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		unixSocketPath = Util::getPath(CONFIG_DIR) + UNIX_SOCKET_NAME;
+#endif
+
+		apiRateLimits.requestRate = API_REQUEST_RATE;
+		apiRateLimits.expensiveRequestRate = API_EXPENSIVE_REQUEST_RATE;
+		apiRateLimits.burstSeconds = API_RATE_BURST_SECONDS;
+		apiRateLimits.userMultiplier = API_USER_RATE_MULTIPLIER;
+
 		extManager = make_unique<ExtensionManager>(this);
 		userManager = make_unique<WebUserManager>(this);
 		contextMenuManager = make_unique<ContextMenuManager>();
@@ -60,6 +98,7 @@ namespace webserver {
 		// Prevent io service from running until we load
 		ios.stop();
 		tasks.stop();
+		backgroundTasks.stop();
 	}
 
 	WebServerManager::~WebServerManager() {
@@ -73,7 +112,7 @@ namespace webserver {
 	}
 
 	bool WebServerManager::isRunning() const noexcept {
-		return !ios.stopped() || !tasks.stopped();
+		return !ios.stopped() || !tasks.stopped() || !backgroundTasks.stopped();
 	}
 
 #if defined _MSC_VER && defined _DEBUG
@@ -116,6 +155,16 @@ namespace webserver {
 		aEndpoint.get_elog().set_ostream(&aStream);
 	}
 
+	bool isUnixSocket(boost::asio::ip::tcp::socket::lowest_layer_type& aSocket) noexcept {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		sockaddr_storage addr;
+		socklen_t addrLen = sizeof(addr);
+		return ::getsockname(aSocket.native_handle(), reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0 && addr.ss_family == AF_UNIX;
+#else
+		return false;
+#endif
+	}
+
 	template<class T>
 	void setEndpointHandlers(T& aEndpoint, bool aIsSecure, WebServerManager* aServer) {
 		aEndpoint.set_http_handler(
@@ -151,6 +200,7 @@ namespace webserver {
 
 		ios.reset();
 		tasks.reset();
+		backgroundTasks.reset();
 		if (!has_io_service) {
 			has_io_service = initialize(errorF);
 		}
@@ -203,6 +253,162 @@ namespace webserver {
 		return endpoint_tls.is_listening();
 	}
 
+	bool WebServerManager::isListeningUnix() const noexcept {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		return unixAcceptor && unixAcceptor->is_open();
+#else
+		return false;
+#endif
+	}
+
+	string WebServerManager::getRemoteIp(boost::asio::ip::tcp::socket::lowest_layer_type& aSocket) noexcept {
+		if (isUnixSocket(aSocket)) {
+			return "localhost";
+		}
+
+		boost::system::error_code ec;
+		auto endpoint = aSocket.remote_endpoint(ec);
+		if (ec) {
+			dcdebug("Failed to get the remote endpoint: %s\n", ec.message().c_str());
+			return Util::emptyString;
+		}
+
+		return endpoint.address().to_string();
+	}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	bool WebServerManager::listenUnix(const ErrorF& errorF) noexcept {
+		if (unixSocketPath.empty()) {
+			return false;
+		}
+
+		const auto endpoint = boost::asio::local::stream_protocol::endpoint(unixSocketPath);
+
+		struct stat st;
+		if (::lstat(unixSocketPath.c_str(), &st) == 0) {
+			string error;
+			if (!S_ISSOCK(st.st_mode)) {
+				error = "the path exists and it isn't a socket";
+			} else {
+				boost::asio::local::stream_protocol::socket probe(ios);
+				boost::system::error_code ec;
+				probe.connect(endpoint, ec);
+				if (!ec) {
+					error = "the socket is being used by another server";
+				}
+			}
+
+			if (!error.empty()) {
+				if (errorF) {
+					errorF("Failed to listen on the local socket " + unixSocketPath + ": " + error);
+				}
+
+				return false;
+			}
+
+			// Left behind by an instance that wasn't shut down cleanly
+			::unlink(unixSocketPath.c_str());
+		}
+
+		bool bound = false;
+		try {
+			auto acceptor = make_unique<boost::asio::local::stream_protocol::acceptor>(ios);
+			acceptor->open();
+			acceptor->bind(endpoint);
+			bound = true;
+
+			// Permissions must be restricted before listening so that other users can't connect in between
+			if (::chmod(unixSocketPath.c_str(), S_IRUSR | S_IWUSR) != 0) {
+				throw Exception("Failed to set socket permissions: " + Util::translateError(errno));
+			}
+
+			acceptor->listen();
+			unixAcceptor = std::move(acceptor);
+		} catch (const std::exception& e) {
+			if (bound) {
+				File::deleteFile(unixSocketPath);
+			}
+
+			if (errorF) {
+				errorF("Failed to listen on the local socket " + unixSocketPath + ": " + string(e.what()));
+			}
+
+			return false;
+		}
+
+		acceptUnix();
+		return true;
+	}
+
+	void WebServerManager::acceptUnix() noexcept {
+		auto socket = make_shared<boost::asio::local::stream_protocol::socket>(ios);
+		unixAcceptor->async_accept(*socket, [this, socket, acceptor = unixAcceptor.get()](const boost::system::error_code& ec) {
+			if (ec == boost::asio::error::operation_aborted || unixAcceptor.get() != acceptor || !acceptor->is_open()) {
+				// Stopped
+				return;
+			}
+
+			if (!ec) {
+				handleUnixAccepted(*socket);
+				acceptUnix();
+				return;
+			}
+
+			// Avoid a busy loop with persistent errors (such as running out of file descriptors)
+			dcdebug("Failed to accept a local socket connection: %s\n", ec.message().c_str());
+
+			auto retryTimer = make_shared<boost::asio::steady_timer>(ios, std::chrono::milliseconds(UNIX_ACCEPT_RETRY_MS));
+			retryTimer->async_wait([this, retryTimer, acceptor](const boost::system::error_code& aError) {
+				if (aError || unixAcceptor.get() != acceptor || !acceptor->is_open()) {
+					return;
+				}
+
+				acceptUnix();
+			});
+		});
+	}
+
+	void WebServerManager::handleUnixAccepted(boost::asio::local::stream_protocol::socket& aSocket) noexcept {
+		// Websocketpp's transport is bound to TCP sockets but it only uses the generic stream operations
+		// so the accepted descriptor can be handed to a regular plain connection
+		// The protocol passed to assign is only a tag for the socket object, endpoint queries 
+		// must not be made for these connections (see isUnixSocket)
+		auto con = endpoint_plain.get_connection();
+		if (!con) {
+			return;
+		}
+
+		auto fd = ::dup(aSocket.native_handle());
+		aSocket.close();
+
+		if (fd < 0) {
+			dcdebug("Failed to duplicate a local socket connection: %s\n", Util::translateError(errno).c_str());
+			return;
+		}
+
+		boost::system::error_code ec;
+		con->get_raw_socket().assign(boost::asio::ip::tcp::v4(), fd, ec);
+		if (ec) {
+			// The descriptor is owned by the connection only after a successful assign
+			::close(fd);
+			dcdebug("Failed to assign a local socket connection: %s\n", ec.message().c_str());
+			return;
+		}
+
+		con->start();
+	}
+
+	void WebServerManager::stopListeningUnix() noexcept {
+		if (!unixAcceptor) {
+			return;
+		}
+
+		boost::system::error_code ec;
+		unixAcceptor->close(ec);
+		File::deleteFile(unixSocketPath);
+	}
+#endif
+
 	template <typename EndpointType>
 	bool listenEndpoint(EndpointType& aEndpoint, const ServerConfig& aConfig, const string& aProtocol, const WebServerManager::ErrorF& errorF) noexcept {
 		if (!aConfig.hasValidConfig()) {
@@ -246,17 +452,19 @@ namespace webserver {
 			return false;
 		}
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		listenUnix(errorF);
+#endif
+
 		ios_threads = make_unique<boost::thread_group>();
-		task_threads = make_unique<boost::thread_group>();
 
 		// Start the ASIO io_service run loop running both endpoints
 		for (int x = 0; x < WEBCFG(SERVER_THREADS).num(); ++x) {
 			ios_threads->create_thread(boost::bind(&boost::asio::io_service::run, &ios));
 		}
 
-		for (int x = 0; x < std::max(WEBCFG(SERVER_THREADS).num() / 2, 1); ++x) {
-			task_threads->create_thread(boost::bind(&boost::asio::io_service::run, &tasks));
-		}
+		taskPool.start(TASK_POOL_MIN_THREADS, TASK_POOL_MAX_THREADS);
+		backgroundTaskPool.start(TASK_POOL_MIN_THREADS, TASK_POOL_MAX_THREADS);
 
 		// Add timers
 		{
@@ -279,18 +487,18 @@ namespace webserver {
 			socketPingTimer->start(false);
 		}
 
+		{
+			lastCpuTime = SystemUtil::getProcessCpuTime();
+			lastTuneTime = std::chrono::steady_clock::now();
+			scheduleTaskPoolTuning(taskPoolTimerGeneration);
+		}
+
 		fire(WebServerManagerListener::Started());
 		return true;
 	}
 
 	WebSocketPtr WebServerManager::getSocket(websocketpp::connection_hdl hdl) const noexcept {
-		RLock l(cs);
-		auto s = sockets.find(hdl);
-		if (s != sockets.end()) {
-			return s->second;
-		}
-
-		return nullptr;
+		return sockets.find(getConnectionKey(hdl));
 	}
 
 	void WebServerManager::onData(const string& aData, TransportType aType, Direction aDirection, const string& aIP) noexcept {
@@ -326,18 +534,15 @@ namespace webserver {
 		vector<WebSocketPtr> inactiveSockets;
 		auto tick = GET_TICK();
 
-		{
-			RLock l(cs);
-			for (const auto& socket : sockets | map_values) {
-				//socket->debugMessage("PING");
-				socket->ping();
-
-				// Disconnect sockets without a session after one minute
-				if (!socket->getSession() && socket->getTimeCreated() + AUTHENTICATION_TIMEOUT * 1000ULL < tick) {
-					inactiveSockets.push_back(socket);
-				}
+		sockets.forEach([&](const WebSocketPtr& socket) {
+			//socket->debugMessage("PING");
+			socket->ping();
+
+			// Disconnect sockets without a session after one minute
+			if (!socket->getSession() && socket->getTimeCreated() + AUTHENTICATION_TIMEOUT * 1000ULL < tick) {
+				inactiveSockets.push_back(socket);
 			}
-		}
+		});
 
 		for (const auto& s : inactiveSockets) {
 			s->close(websocketpp::close::status::policy_violation, "Authentication timeout");
@@ -345,38 +550,104 @@ namespace webserver {
 	}
 
 	context_ptr WebServerManager::handleInitTls(websocketpp::connection_hdl hdl) {
-		//std::cout << "on_tls_init called with hdl: " << hdl.lock().get() << std::endl;
+		const auto customCert = WEBCFG(TLS_CERT_PATH).str();
+		const auto customKey = WEBCFG(TLS_CERT_KEY_PATH).str();
+
+		bool useCustom = !customCert.empty() && !customKey.empty();
+
+		TlsContextInfo info;
+		info.certPath = useCustom ? customCert : SETTING(TLS_CERTIFICATE_FILE);
+		info.keyPath = useCustom ? customKey : SETTING(TLS_PRIVATE_KEY_FILE);
+		info.certModified = File::getLastModified(info.certPath);
+		info.keyModified = File::getLastModified(info.keyPath);
+		info.options = getTlsContextOptions();
+		info.coreCertPath = SETTING(TLS_CERTIFICATE_FILE);
+		info.coreKeyPath = SETTING(TLS_PRIVATE_KEY_FILE);
+		info.trustedCertsPath = SETTING(TLS_TRUSTED_CERTIFICATES_PATH);
+
+		// Reuse the existing context unless the certificate has changed
+		// (sharing the context is also required for session resumption)
+		{
+			Lock l(tlsContextCS);
+			if (tlsContext && tlsContextInfo == info) {
+				return tlsContext;
+			}
+		}
+
+		auto start = GET_TICK();
+
+		string error;
+		auto ctx = createTlsContext(info, error);
+		if (!ctx) {
+			// Report each failing configuration once
+			bool report = false;
+
+			{
+				Lock l(tlsContextCS);
+				if (!(tlsContextErrorInfo == info)) {
+					tlsContextErrorInfo = info;
+					report = true;
+				}
+			}
+
+			if (report) {
+				log("Failed to initialize the TLS context: " + error, LogMessage::SEV_ERROR);
+			}
+
+			// websocketpp will fail the connection with an invalid TLS context error
+			return nullptr;
+		}
+
+		dcdebug("TLS context created in %d ms\n", static_cast<int>(GET_TICK() - start));
+
+		Lock l(tlsContextCS);
+		tlsContext = ctx;
+		tlsContextInfo = info;
+		tlsContextErrorInfo = TlsContextInfo();
+		return ctx;
+	}
+
+	long WebServerManager::getTlsContextOptions() noexcept {
+		return boost::asio::ssl::context::default_workarounds |
+			boost::asio::ssl::context::no_sslv2 |
+			boost::asio::ssl::context::no_sslv3 |
+			boost::asio::ssl::context::no_tlsv1 |
+			boost::asio::ssl::context::no_tlsv1_1 |
+			boost::asio::ssl::context::single_dh_use |
+			boost::asio::ssl::context::no_compression;
+	}
+
+	context_ptr WebServerManager::createTlsContext(const TlsContextInfo& aInfo, string& error_) noexcept {
 		context_ptr ctx(new boost::asio::ssl::context(boost::asio::ssl::context::tls));
 
 		try {
-			ctx->set_options(boost::asio::ssl::context::default_workarounds |
-				boost::asio::ssl::context::no_sslv2 |
-				boost::asio::ssl::context::no_sslv3 |
-				boost::asio::ssl::context::no_tlsv1 |
-				boost::asio::ssl::context::no_tlsv1_1 |
-				boost::asio::ssl::context::single_dh_use |
-				boost::asio::ssl::context::no_compression
-			);
+			ctx->set_options(aInfo.options);
 
-			const auto customCert = WEBCFG(TLS_CERT_PATH).str();
-			const auto customKey = WEBCFG(TLS_CERT_KEY_PATH).str();
+			ctx->use_certificate_file(aInfo.certPath, boost::asio::ssl::context::pem);
+			ctx->use_private_key_file(aInfo.keyPath, boost::asio::ssl::context::pem);
 
-			bool useCustom = !customCert.empty() && !customKey.empty();
+			CryptoManager::setContextOptions(ctx->native_handle(), true);
+		} catch (const std::exception& e) {
+			error_ = e.what();
+			dcdebug("TLS init failed: %s\n", e.what());
+			return nullptr;
+		}
 
-			ctx->use_certificate_file(useCustom ? customCert : SETTING(TLS_CERTIFICATE_FILE), boost::asio::ssl::context::pem);
-			ctx->use_private_key_file(useCustom ? customKey : SETTING(TLS_PRIVATE_KEY_FILE), boost::asio::ssl::context::pem);
+		// Session resumption (server-side cache for session IDs and session tickets)
+		{
+			static const string sessionIdContext = "airdcpp-webapi";
 
-			CryptoManager::setContextOptions(ctx->native_handle(), true);
-		} catch (std::exception& e) {
-			dcdebug("TLS init failed: %s", e.what());
+			auto native = ctx->native_handle();
+			SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+			SSL_CTX_set_session_id_context(native, reinterpret_cast<const unsigned char*>(sessionIdContext.c_str()), static_cast<unsigned int>(sessionIdContext.size()));
+			SSL_CTX_clear_options(native, SSL_OP_NO_TICKET);
 		}
 
 		return ctx;
 	}
 
 	void WebServerManager::disconnectSockets(const string& aMessage) noexcept {
-		RLock l(cs);
-		for (const auto& socket : sockets | map_values) {
+		for (const auto& socket : sockets.values()) {
 			socket->close(websocketpp::close::status::going_away, aMessage);
 		}
 	}
@@ -389,6 +660,15 @@ namespace webserver {
 		if (socketPingTimer)
 			socketPingTimer->stop(true);
 
+		{
+			taskPoolTimerGeneration++;
+
+			boost::system::error_code ec;
+			taskPoolTimer.cancel(ec);
+		}
+
+		timerWheel.stop();
+
 		fire(WebServerManagerListener::Stopping());
 
 		if(endpoint_plain.is_listening())
@@ -396,53 +676,120 @@ namespace webserver {
 		if(endpoint_tls.is_listening())
 			endpoint_tls.stop_listening();
 
-		disconnectSockets("Shutting down");
-
-		bool hasSockets = false;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		stopListeningUnix();
+#endif
 
-		for (;;) {
-			{
-				RLock l(cs);
-				hasSockets = !sockets.empty();
-			}
+		disconnectSockets("Shutting down");
 
-			if (hasSockets) {
-				Thread::sleep(50);
-			} else {
-				break;
-			}
+		while (!sockets.empty()) {
+			Thread::sleep(50);
 		}
 
 		ios.stop();
 		tasks.stop();
+		backgroundTasks.stop();
 
-		if (task_threads)
-			task_threads->join_all();
+		taskPool.join();
+		backgroundTaskPool.join();
 
 		if (ios_threads)
 			ios_threads->join_all();
 
-		task_threads.reset();
 		ios_threads.reset();
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		unixAcceptor.reset();
+#endif
+
 		fire(WebServerManagerListener::Stopped());
 	}
 
 	WebSocketPtr WebServerManager::getSocket(LocalSessionId aSessionToken) noexcept {
-		RLock l(cs);
-		auto i = find_if(sockets | map_values, [&](const WebSocketPtr& s) {
-			return s->getSession() && s->getSession()->getId() == aSessionToken;
-		});
+		return sessionSockets.find(aSessionToken);
+	}
+
+	void WebServerManager::onSocketSessionChanged(const WebSocketPtr& aSocket, const SessionPtr& aOldSession, const SessionPtr& aNewSession) noexcept {
+		if (aOldSession) {
+			sessionSockets.erase(aOldSession->getId(), aSocket);
+		}
 
-		return i.base() == sockets.end() ? nullptr : *i;
+		if (aNewSession) {
+			sessionSockets.set(aNewSession->getId(), aSocket);
+		}
+	}
+
+	WebServerManager::WebSocketList WebServerManager::getSockets() const noexcept {
+		return sockets.values();
 	}
 
 	TimerPtr WebServerManager::addTimer(CallBack&& aCallBack, time_t aIntervalMillis, const Timer::CallbackWrapper& aCallbackWrapper) noexcept {
-		return make_shared<Timer>(move(aCallBack), tasks, aIntervalMillis, aCallbackWrapper);
+		return make_shared<Timer>(move(aCallBack), timerWheel, aIntervalMillis, aCallbackWrapper, &metrics.getTimerLag());
+	}
+
+	void WebServerManager::addAsyncTask(CallBack&& aCallBack, TaskPriority aPriority) noexcept {
+		auto& service = aPriority == PRIORITY_INTERACTIVE ? tasks : backgroundTasks;
+		auto& stats = aPriority == PRIORITY_INTERACTIVE ? interactiveTaskStats : backgroundTaskStats;
+
+		auto queued = stats.onTaskQueued();
+		service.post([&stats, queued, aCallBack = move(aCallBack)] {
+			stats.onTaskStarted(queued);
+			aCallBack();
+		});
+	}
+
+	void WebServerManager::addDelayedTask(CallBack&& aCallBack, time_t aDelayMillis, TaskPriority aPriority) noexcept {
+		auto entry = make_shared<TimerWheel::Entry>([this, aCallBack = move(aCallBack), aPriority] {
+			addAsyncTask(CallBack(aCallBack), aPriority);
+		});
+
+		// The posted callback keeps the entry alive until it has expired
+		timerWheel.schedule(entry, aDelayMillis);
+	}
+
+	json WebServerManager::getTaskQueueStats() const noexcept {
+		return {
+			{ "interactive", interactiveTaskStats.toJson() },
+			{ "background", backgroundTaskStats.toJson() },
+		};
+	}
+
+	void WebServerManager::scheduleTaskPoolTuning(uint64_t aGeneration) noexcept {
+		taskPoolTimer.expires_after(std::chrono::seconds(TASK_POOL_TUNE_INTERVAL));
+		taskPoolTimer.async_wait([this, aGeneration](const boost::system::error_code& aError) {
+			if (aError || aGeneration != taskPoolTimerGeneration) {
+				return;
+			}
+
+			tuneTaskPools();
+			scheduleTaskPoolTuning(aGeneration);
+		});
 	}
 
-	void WebServerManager::addAsyncTask(CallBack&& aCallBack) noexcept {
-		tasks.post(aCallBack);
+	void WebServerManager::tuneTaskPools() noexcept {
+		auto cpuTime = SystemUtil::getProcessCpuTime();
+		auto now = std::chrono::steady_clock::now();
+
+		// CPU time of all threads in the process compared to the available CPU time
+		auto wallTime = std::chrono::duration<double>(now - lastTuneTime).count();
+		auto cpuSeconds = static_cast<double>(cpuTime >= lastCpuTime ? cpuTime - lastCpuTime : 0) / 1000000;
+		auto cpuUsage = wallTime <= 0 ? 0 : cpuSeconds / (wallTime * max(boost::thread::hardware_concurrency(), 1U));
+
+		lastCpuTime = cpuTime;
+		lastTuneTime = now;
+
+		taskPool.tune(cpuUsage);
+		backgroundTaskPool.tune(cpuUsage);
+	}
+
+	json WebServerManager::getTaskPoolStats() const noexcept {
+		return {
+			{ "io", {
+				{ "threads", WEBCFG(SERVER_THREADS).num() },
+			} },
+			{ "interactive", taskPool.toJson() },
+			{ "background", backgroundTaskPool.toJson() },
+		};
 	}
 
 	void WebServerManager::setDirty() noexcept {
@@ -450,27 +797,22 @@ namespace webserver {
 	}
 
 	void WebServerManager::addSocket(websocketpp::connection_hdl hdl, const WebSocketPtr& aSocket) noexcept {
-		{
-			WLock l(cs);
-			sockets.emplace(hdl, aSocket);
-		}
+		sockets.emplace(getConnectionKey(hdl), aSocket);
 
 		fire(WebServerManagerListener::SocketConnected(), aSocket);
 	}
 
 	void WebServerManager::handleSocketDisconnected(websocketpp::connection_hdl hdl) {
-		WebSocketPtr socket = nullptr;
-
-		{
-			WLock l(cs);
-			auto s = sockets.find(hdl);
-			dcassert(s != sockets.end());
-			if (s == sockets.end()) {
-				return;
-			}
+		auto socket = sockets.erase(getConnectionKey(hdl));
+		dcassert(socket);
+		if (!socket) {
+			return;
+		}
 
-			socket = s->second;
-			sockets.erase(s);
+		// The session is reset by the listeners but the socket must not be returned by session lookups anymore
+		auto session = socket->getSession();
+		if (session) {
+			sessionSockets.erase(session->getId(), socket);
 		}
 
 		dcdebug("Socket disconnected: %s\n", socket->getSession() ? socket->getSession()->getAuthToken().c_str() : "(no session)");
@@ -526,6 +868,21 @@ namespace webserver {
 					loadServer(xml, "Server", plainServerConfig, false);
 					loadServer(xml, "TLSServer", tlsServerConfig, true);
 
+					if (xml.findChild("UnixSocket")) {
+						// An empty path disables the local socket
+						unixSocketPath = xml.getChildAttrib("Path");
+					}
+					xml.resetCurrentChild();
+
+					if (xml.findChild("ApiRateLimits")) {
+						// Zero rate disables the limit
+						apiRateLimits.requestRate = max(Util::toDouble(xml.getChildAttrib("RequestRate")), 0.0);
+						apiRateLimits.expensiveRequestRate = max(Util::toDouble(xml.getChildAttrib("ExpensiveRequestRate")), 0.0);
+						apiRateLimits.burstSeconds = max(Util::toDouble(xml.getChildAttrib("BurstSeconds")), 1.0);
+						apiRateLimits.userMultiplier = max(Util::toDouble(xml.getChildAttrib("UserMultiplier")), 1.0);
+					}
+					xml.resetCurrentChild();
+
 					if (xml.findChild("Threads")) {
 						xml.stepIn();
 						WEBCFG(SERVER_THREADS).setValue(max(Util::toInt(xml.getData()), 1));
@@ -590,6 +947,23 @@ namespace webserver {
 			xml.addChildAttrib("Certificate", WEBCFG(TLS_CERT_PATH).str());
 			xml.addChildAttrib("CertificateKey", WEBCFG(TLS_CERT_KEY_PATH).str());
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+			if (unixSocketPath != Util::getPath(CONFIG_DIR) + UNIX_SOCKET_NAME) {
+				xml.addTag("UnixSocket");
+				xml.addChildAttrib("Path", unixSocketPath);
+			}
+#endif
+
+			if (apiRateLimits.requestRate != API_REQUEST_RATE || apiRateLimits.expensiveRequestRate != API_EXPENSIVE_REQUEST_RATE ||
+				apiRateLimits.burstSeconds != API_RATE_BURST_SECONDS || apiRateLimits.userMultiplier != API_USER_RATE_MULTIPLIER) {
+
+				xml.addTag("ApiRateLimits");
+				xml.addChildAttrib("RequestRate", Util::toString(apiRateLimits.requestRate));
+				xml.addChildAttrib("ExpensiveRequestRate", Util::toString(apiRateLimits.expensiveRequestRate));
+				xml.addChildAttrib("BurstSeconds", Util::toString(apiRateLimits.burstSeconds));
+				xml.addChildAttrib("UserMultiplier", Util::toString(apiRateLimits.userMultiplier));
+			}
+
 			if (!WEBCFG(SERVER_THREADS).isDefault()) {
 				xml.addTag("Threads");
 				xml.stepIn();
@@ -21,12 +21,17 @@
 
 #include "stdinc.h"
 
+#include "ApiMetrics.h"
 #include "ApiRouter.h"
+#include "EventBus.h"
 #include "FileServer.h"
 #include "ApiRequest.h"
 
 #include "HttpUtil.h"
+#include "ShardedMap.h"
 #include "SystemUtil.h"
+#include "TaskPool.h"
+#include "TaskQueueStats.h"
 #include "Timer.h"
 #include "WebServerManagerListener.h"
 #include "WebUserManager.h"
@@ -50,6 +55,18 @@ namespace webserver {
 	class ExtensionManager;
 	class WebUserManager;
 
+	struct ApiRateLimits {
+		// Requests per second for a session (0 = unlimited)
+		double requestRate = 0;
+		double expensiveRequestRate = 0;
+
+		// Bucket size in seconds of the rate
+		double burstSeconds = 0;
+
+		// Limits of a user (shared by all sessions of the user) relative to the session limits
+		double userMultiplier = 0;
+	};
+
 	struct ServerConfig {
 		ServerConfig(ServerSettingItem& aPort, ServerSettingItem& aBindAddress) : port(aPort), bindAddress(aBindAddress) {
 
@@ -72,10 +89,50 @@ namespace webserver {
 
 	class WebServerManager : public dcpp::Singleton<WebServerManager>, public Speaker<WebServerManagerListener> {
 	public:
+		// Interactive tasks (API requests) are run by a separate thread pool so that 
+		// they won't have to wait behind queued background tasks (listener events, timers)
+		enum TaskPriority {
+			PRIORITY_INTERACTIVE,
+			PRIORITY_BACKGROUND
+		};
+
+		// Timers are always run as background tasks
 		TimerPtr addTimer(CallBack&& aCallBack, time_t aIntervalMillis, const Timer::CallbackWrapper& aCallbackWrapper = nullptr) noexcept;
-		void addAsyncTask(CallBack&& aCallBack) noexcept;
+		void addAsyncTask(CallBack&& aCallBack, TaskPriority aPriority = PRIORITY_BACKGROUND) noexcept;
+
+		// Run a task once after the given delay
+		void addDelayedTask(CallBack&& aCallBack, time_t aDelayMillis, TaskPriority aPriority = PRIORITY_BACKGROUND) noexcept;
 		void setDirty() noexcept;
 
+		// Used for creating per-session executors (socket messages are interactive tasks)
+		boost::asio::io_service& getTaskService() noexcept {
+			return tasks;
+		}
+
+		// The service running the sockets (asynchronous network operations only, handlers must not block)
+		boost::asio::io_service& getIOService() noexcept {
+			return ios;
+		}
+
+		json getTaskQueueStats() const noexcept;
+		json getTaskPoolStats() const noexcept;
+		const TaskPool& getTaskPool(TaskPriority aPriority) const noexcept {
+			return aPriority == PRIORITY_INTERACTIVE ? taskPool : backgroundTaskPool;
+		}
+		const TaskQueueStats& getTaskQueueStats(TaskPriority aPriority) const noexcept {
+			return aPriority == PRIORITY_INTERACTIVE ? interactiveTaskStats : backgroundTaskStats;
+		}
+		TaskQueueStats& getTaskQueueStats(TaskPriority aPriority) noexcept {
+			return aPriority == PRIORITY_INTERACTIVE ? interactiveTaskStats : backgroundTaskStats;
+		}
+
+		const TimerWheel& getTimerWheel() const noexcept {
+			return timerWheel;
+		}
+
+		typedef vector<WebSocketPtr> WebSocketList;
+		WebSocketList getSockets() const noexcept;
+
 		WebServerManager();
 		~WebServerManager();
 
@@ -92,6 +149,9 @@ namespace webserver {
 		// Reset sessions for associated sockets
 		WebSocketPtr getSocket(LocalSessionId aSessionToken) noexcept;
 
+		// Keeps the session index up to date (called by WebSocket)
+		void onSocketSessionChanged(const WebSocketPtr& aSocket, const SessionPtr& aOldSession, const SessionPtr& aNewSession) noexcept;
+
 		bool load(const ErrorF& aErrorF) noexcept;
 		bool save(const ErrorF& aErrorF) noexcept;
 
@@ -107,6 +167,14 @@ namespace webserver {
 			return *contextMenuManager.get();
 		}
 
+		EventBus& getEventBus() noexcept {
+			return eventBus;
+		}
+
+		ApiMetrics& getApiMetrics() noexcept {
+			return metrics;
+		}
+
 		bool hasValidConfig() const noexcept;
 
 		ServerConfig& getPlainServerConfig() noexcept {
@@ -117,6 +185,10 @@ namespace webserver {
 			return tlsServerConfig;
 		}
 
+		const ApiRateLimits& getApiRateLimits() const noexcept {
+			return apiRateLimits;
+		}
+
 		string getConfigPath() const noexcept;
 		string getResourcePath() const noexcept {
 			return fileServer.getResourcePath();
@@ -127,6 +199,16 @@ namespace webserver {
 		bool isListeningPlain() const noexcept;
 		bool isListeningTls() const noexcept;
 
+		// Local (Unix domain) socket serving the same API as the plain HTTP endpoint
+		// Access is restricted with file permissions so that only the owner can connect
+		bool isListeningUnix() const noexcept;
+		const string& getUnixSocketPath() const noexcept {
+			return unixSocketPath;
+		}
+
+		// Remote IP of a connection (clients connected via the Unix socket are reported as localhost)
+		static string getRemoteIp(boost::asio::ip::tcp::socket::lowest_layer_type& aSocket) noexcept;
+
 		static boost::asio::ip::tcp getDefaultListenProtocol() noexcept;
 
 		const CallBack getShutdownF() const noexcept {
@@ -163,11 +245,34 @@ namespace webserver {
 			}
 
 			// Increase concurrency as messages received from each socket will always use the same thread
-			addAsyncTask([=] {
+			const auto queuedAt = std::chrono::steady_clock::now();
+			auto task = [=] {
 				// onData call must be async to avoid possible deadlocks due to possible simultaneous disconnected/server state listener events
 				onData(msg->get_payload(), TransportType::TYPE_SOCKET, Direction::INCOMING, socket->getIp());
-				api.handleSocketRequest(msg->get_payload(), socket, aIsSecure);
-			});
+				api.handleSocketRequest(msg->get_payload(), socket, aIsSecure, queuedAt);
+			};
+
+			// Messages of authenticated sessions are handled in order
+			// Hook completions must bypass the queue as the session may be waiting for them in a previous request
+			auto session = socket->getSession();
+			if (session && !WebSocket::isHookCompletionRequest(msg->get_payload())) {
+				// Reject flooding clients before anything gets queued
+				if (!session->admitRequest(WebSocket::isExpensiveRequest(msg->get_payload()))) {
+					socket->sendApiResponse(
+						nullptr, 
+						ApiRequest::toResponseErrorStr("Request rate limit exceeded"), 
+						websocketpp::http::status_code::too_many_requests, 
+						WebSocket::parseCallbackId(msg->get_payload())
+					);
+					return;
+				}
+
+				session->getExecutor().post([session, task] {
+					task();
+				});
+			} else {
+				addAsyncTask(task, PRIORITY_INTERACTIVE);
+			}
 		}
 
 
@@ -180,7 +285,7 @@ namespace webserver {
 		void handleHttpRequest(EndpointType* s, websocketpp::connection_hdl hdl, bool aIsSecure) {
 			// Blocking HTTP Handler
 			auto con = s->get_con_from_hdl(hdl);
-			auto ip = con->get_raw_socket().remote_endpoint().address().to_string();
+			auto ip = getRemoteIp(con->get_raw_socket());
 
 			SessionPtr session = nullptr;
 
@@ -196,7 +301,15 @@ namespace webserver {
 			}
 
 			if (con->get_resource().length() >= 4 && con->get_resource().compare(0, 4, "/api") == 0) {
+				if (session && !session->admitRequest(con->get_request().get_method() != "GET")) {
+					con->set_body(ApiRequest::toResponseErrorStr("Request rate limit exceeded").dump());
+					con->set_status(websocketpp::http::status_code::too_many_requests);
+					return;
+				}
+
 				con->defer_http_response();
+
+				const auto queuedAt = std::chrono::steady_clock::now();
 				addAsyncTask([=] {
 					onData(con->get_resource() + ": " + con->get_request().get_body(), TransportType::TYPE_HTTP_API, Direction::INCOMING, ip);
 
@@ -241,13 +354,14 @@ namespace webserver {
 						aIsSecure,
 						ip,
 						session,
-						deferredF
+						deferredF,
+						queuedAt
 					);
 
 					if (!isDeferred) {
 						responseF(status, output, apiError);
 					}
-				});
+				}, PRIORITY_INTERACTIVE);
 			} else {
 				onData(con->get_request().get_method() + " " + con->get_resource(), TransportType::TYPE_HTTP_FILE, Direction::INCOMING, ip);
 
@@ -265,7 +379,7 @@ namespace webserver {
 
 					con->append_header("Connection", "close"); // Workaround for https://github.com/zaphoyd/websocketpp/issues/890
 
-					if (HttpUtil::isStatusOk(aStatus)) {
+					if (HttpUtil::isStatusOk(aStatus) || aStatus == websocketpp::http::status_code::not_modified) {
 						// Don't set any incomplete/invalid headers in case of errors...
 						for (const auto& p : aHeaders) {
 							con->append_header(p.first, p.second);
@@ -314,6 +428,38 @@ namespace webserver {
 
 		context_ptr handleInitTls(websocketpp::connection_hdl hdl);
 
+		struct TlsContextInfo {
+			string certPath;
+			string keyPath;
+			time_t certModified = 0;
+			time_t keyModified = 0;
+
+			// Protocol options and the core TLS settings
+			long options = 0;
+			string coreCertPath;
+			string coreKeyPath;
+			string trustedCertsPath;
+
+			bool operator==(const TlsContextInfo& aOther) const noexcept {
+				return certPath == aOther.certPath && keyPath == aOther.keyPath && 
+					certModified == aOther.certModified && keyModified == aOther.keyModified &&
+					options == aOther.options && coreCertPath == aOther.coreCertPath && 
+					coreKeyPath == aOther.coreKeyPath && trustedCertsPath == aOther.trustedCertsPath;
+			}
+		};
+
+		static long getTlsContextOptions() noexcept;
+
+		// Returns nullptr in case of errors
+		static context_ptr createTlsContext(const TlsContextInfo& aInfo, string& error_) noexcept;
+
+		context_ptr tlsContext;
+		TlsContextInfo tlsContextInfo;
+
+		// Last configuration that failed (avoid logging the same error for each connection)
+		TlsContextInfo tlsContextErrorInfo;
+		CriticalSection tlsContextCS;
+
 		void addSocket(websocketpp::connection_hdl hdl, const WebSocketPtr& aSocket) noexcept;
 		WebSocketPtr getSocket(websocketpp::connection_hdl hdl) const noexcept;
 		bool listen(const ErrorF& errorF);
@@ -324,35 +470,74 @@ namespace webserver {
 		ServerConfig tlsServerConfig;
 
 		void loadServer(SimpleXML& xml_, const string& aTagName, ServerConfig& config_, bool aTls) noexcept;
-		void pingTimer() noexcept;
 
-		mutable SharedMutex cs;
+		ApiRateLimits apiRateLimits;
+
+		string unixSocketPath;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+		unique_ptr<boost::asio::local::stream_protocol::acceptor> unixAcceptor;
+
+		bool listenUnix(const ErrorF& errorF) noexcept;
+		void stopListeningUnix() noexcept;
+		void acceptUnix() noexcept;
+		void handleUnixAccepted(boost::asio::local::stream_protocol::socket& aSocket) noexcept;
+#endif
+		void pingTimer() noexcept;
 
 		// set up an external io_service to run both endpoints on. This is not
 		// strictly necessary, but simplifies thread management a bit.
 		boost::asio::io_service ios;
 		boost::asio::io_service tasks;
 		boost::asio::io_service::work work;
+		boost::asio::io_service backgroundTasks;
+		boost::asio::io_service::work backgroundWork;
+
+		TaskQueueStats interactiveTaskStats;
+		TaskQueueStats backgroundTaskStats;
 		bool has_io_service = false;
 
-		typedef vector<WebSocketPtr> WebSocketList;
-		std::map<websocketpp::connection_hdl, WebSocketPtr, std::owner_less<websocketpp::connection_hdl>> sockets;
+		// Connections are identified by the address of the connection object (hashing weak pointers isn't possible)
+		static const void* getConnectionKey(websocketpp::connection_hdl hdl) noexcept {
+			return hdl.lock().get();
+		}
+
+		ShardedMap<const void*, WebSocketPtr> sockets;
+		ShardedMap<LocalSessionId, WebSocketPtr> sessionSockets;
 
 		ApiRouter api;
 		FileServer fileServer;
+		EventBus eventBus;
+		ApiMetrics metrics;
 
 		unique_ptr<WebUserManager> userManager;
 		unique_ptr<ExtensionManager> extManager;
 		unique_ptr<ContextMenuManager> contextMenuManager;
 
+		// Drives all timers (and delayed tasks)
+		TimerWheel timerWheel;
+
 		TimerPtr minuteTimer;
 		TimerPtr socketPingTimer;
 
+		// Runs on the socket IO service so that the tuning isn't delayed by the task pools it is resizing
+		boost::asio::steady_timer taskPoolTimer;
+
+		// Incremented when the server is stopped, handlers from earlier runs are ignored
+		atomic<uint64_t> taskPoolTimerGeneration { 0 };
+
+		void scheduleTaskPoolTuning(uint64_t aGeneration) noexcept;
+		void tuneTaskPools() noexcept;
+
+		// Process CPU time (microseconds) at the previous task pool tuning
+		uint64_t lastCpuTime = 0;
+		std::chrono::steady_clock::time_point lastTuneTime;
+
 		server_plain endpoint_plain;
 		server_tls endpoint_tls;
 
 		unique_ptr<boost::thread_group> ios_threads;
-		unique_ptr<boost::thread_group> task_threads;
+		TaskPool taskPool;
+		TaskPool backgroundTaskPool;
 
 		CallBack shutdownF;
 		bool isDirty = false;
@@ -27,6 +27,7 @@
 #include <airdcpp/TimerManager.h>
 #include <airdcpp/Util.h>
 
+#include <charconv>
 
 namespace webserver {
 	WebSocket::WebSocket(bool aIsSecure, websocketpp::connection_hdl aHdl, const websocketpp::http::parser::request& aRequest, server_plain* aServer, WebServerManager* aWsm) : WebSocket(aIsSecure, aHdl, aRequest, aWsm) {
@@ -46,10 +47,10 @@ namespace webserver {
 		try {
 			if (secure) {
 				auto conn = tlsServer->get_con_from_hdl(hdl);
-				ip = conn->get_raw_socket().remote_endpoint().address().to_string();
+				ip = WebServerManager::getRemoteIp(conn->get_raw_socket().lowest_layer());
 			} else {
 				auto conn = plainServer->get_con_from_hdl(hdl);
-				ip = conn->get_raw_socket().remote_endpoint().address().to_string();
+				ip = WebServerManager::getRemoteIp(conn->get_raw_socket());
 			}
 		} catch (const std::exception& e) {
 			dcdebug("WebSocket::getIp failed: %s\n", e.what());
@@ -66,6 +67,13 @@ namespace webserver {
 		dcdebug("Websocket was deleted\n");
 	}
 
+	void WebSocket::setSession(const SessionPtr& aSession) noexcept {
+		auto oldSession = session;
+		session = aSession;
+
+		wsm->onSocketSessionChanged(shared_from_this(), oldSession, aSession);
+	}
+
 	void WebSocket::sendApiResponse(const json& aResponseJson, const json& aErrorJson, websocketpp::http::status_code::value aCode, int aCallbackId) noexcept {
 		json j;
 
@@ -123,13 +131,17 @@ namespace webserver {
 			throw e;
 		}
 
-		wsm->onData(str, TransportType::TYPE_SOCKET, Direction::OUTGOING, getIp());
+		sendSerialized(str);
+	}
+
+	void WebSocket::sendSerialized(const string& aData) noexcept {
+		wsm->onData(aData, TransportType::TYPE_SOCKET, Direction::OUTGOING, getIp());
 
 		try {
 			if (secure) {
-				tlsServer->send(hdl, str, websocketpp::frame::opcode::text);
+				tlsServer->send(hdl, aData, websocketpp::frame::opcode::text);
 			} else {
-				plainServer->send(hdl, str, websocketpp::frame::opcode::text);
+				plainServer->send(hdl, aData, websocketpp::frame::opcode::text);
 			}
 		} catch (const std::exception& e) {
 			logError("Failed to send data: " + string(e.what()), websocketpp::log::elevel::fatal);
@@ -178,4 +190,82 @@ namespace webserver {
 		data_ = JsonUtil::getOptionalRawField("data", requestJson);
 		method_ = requestJson.at("method");
 	}
-}
\ No newline at end of file
+
+	bool WebSocket::isHookCompletionRequest(const string& aRequest) noexcept {
+		auto pos = aRequest.find("\"path\"");
+		if (pos == string::npos) {
+			return false;
+		}
+
+		pos = aRequest.find(':', pos + 6);
+		if (pos == string::npos) {
+			return false;
+		}
+
+		pos = aRequest.find_first_not_of(" \t\r\n", pos + 1);
+		if (pos == string::npos || aRequest[pos] != '"') {
+			return false;
+		}
+
+		// Hook paths don't contain escaped characters
+		auto end = aRequest.find('"', pos + 1);
+		if (end == string::npos) {
+			return false;
+		}
+
+		static const boost::regex hookCompletionReg(R"(/hooks/\w+/(\d+/(resolve|reject)|complete)$)");
+		return boost::regex_search(aRequest.begin() + pos + 1, aRequest.begin() + end, hookCompletionReg);
+	}
+
+	bool WebSocket::isExpensiveRequest(const string& aRequest) noexcept {
+		auto pos = aRequest.find("\"method\"");
+		if (pos == string::npos) {
+			return true;
+		}
+
+		pos = aRequest.find('"', aRequest.find(':', pos + 8));
+		if (pos == string::npos) {
+			return true;
+		}
+
+		return Util::strnicmp(aRequest.c_str() + pos, "\"GET\"", 5) != 0;
+	}
+
+	int WebSocket::parseCallbackId(const string& aRequest) noexcept {
+		auto pos = aRequest.find("\"callback_id\"");
+		if (pos == string::npos) {
+			return -1;
+		}
+
+		pos = aRequest.find(':', pos + 13);
+		if (pos == string::npos) {
+			return -1;
+		}
+
+		pos = aRequest.find_first_not_of(" \t\r\n", pos + 1);
+		if (pos == string::npos) {
+			return -1;
+		}
+
+		int callbackId = -1;
+		if (std::from_chars(aRequest.data() + pos, aRequest.data() + aRequest.size(), callbackId).ec != std::errc()) {
+			return -1;
+		}
+
+		return callbackId;
+	}
+
+	size_t WebSocket::getBufferedAmount() const noexcept {
+		try {
+			if (secure) {
+				return tlsServer->get_con_from_hdl(hdl)->get_buffered_amount();
+			} else {
+				return plainServer->get_con_from_hdl(hdl)->get_buffered_amount();
+			}
+		} catch (const std::exception&) {
+			// Disconnected
+		}
+
+		return 0;
+	}
+}
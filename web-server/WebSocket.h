@@ -29,7 +29,7 @@
 namespace webserver {
 	// WebSockets are owned by WebServerManager and API modules
 
-	class WebSocket {
+	class WebSocket : public std::enable_shared_from_this<WebSocket> {
 	public:
 		WebSocket(bool aIsSecure, websocketpp::connection_hdl aHdl, const websocketpp::http::parser::request& aRequest, server_plain* aServer, WebServerManager* aWsm);
 		WebSocket(bool aIsSecure, websocketpp::connection_hdl aHdl, const websocketpp::http::parser::request& aRequest, server_tls* aServer, WebServerManager* aWsm);
@@ -37,7 +37,12 @@ namespace webserver {
 
 		void close(websocketpp::close::status::value aCode, const std::string& aMsg);
 
-		IGETSET(SessionPtr, session, Session, nullptr);
+		SessionPtr getSession() const noexcept {
+			return session;
+		}
+
+		// Updates the session index of WebServerManager as well
+		void setSession(const SessionPtr& aSession) noexcept;
 
 		// Send raw data
 		// Throws on JSON conversion errors (possibly because of failing UTF-8 validation...)
@@ -46,6 +51,9 @@ namespace webserver {
 		// NMDC code can't be trusted to parse the incoming messages without incorrectly 
 		// splitting multibyte character sequences in malformed received data...
 		void sendPlain(const json& aJson);
+
+		// Send data that has been serialized already (e.g. events shared between multiple sockets)
+		void sendSerialized(const string& aData) noexcept;
 		void sendApiResponse(const json& aJsonResponse, const json& aErrorJson, websocketpp::http::status_code::value aCode, int aCallbackId) noexcept;
 
 		WebSocket(WebSocket&) = delete;
@@ -57,6 +65,9 @@ namespace webserver {
 
 		void ping() noexcept;
 
+		// Number of bytes waiting to be sent
+		size_t getBufferedAmount() const noexcept;
+
 		void logError(const string& aMessage, websocketpp::log::level aErrorLevel) const noexcept;
 		void debugMessage(const string& aMessage) const noexcept;
 
@@ -70,6 +81,18 @@ namespace webserver {
 
 		const websocketpp::http::parser::request& getRequest() noexcept;
 		static void parseRequest(const string& aRequest, int& callbackId_, string& method_, string& path_, json& data_);
+
+		// Returns true if the message resolves or rejects a pending hook action
+		// Only the path field is scanned (see isExpensiveRequest)
+		static bool isHookCompletionRequest(const string& aRequest) noexcept;
+
+		// Requests other than GET are subject to the stricter rate limits
+		// Only the method field is scanned as the message shouldn't be parsed before it's admitted
+		static bool isExpensiveRequest(const string& aRequest) noexcept;
+
+		// Used for responding to rejected requests, scanned in the same way as the method (without parsing the message)
+		// Returns -1 if the callback ID wasn't found
+		static int parseCallbackId(const string& aRequest) noexcept;
 	protected:
 		WebSocket(bool aIsSecure, websocketpp::connection_hdl aHdl, const websocketpp::http::parser::request& aRequest, WebServerManager* aWsm);
 	private:
@@ -79,6 +102,7 @@ namespace webserver {
 		};
 
 		const websocketpp::connection_hdl hdl;
+		SessionPtr session = nullptr;
 		WebServerManager* wsm;
 		const bool secure;
 		const time_t timeCreated;
@@ -21,6 +21,7 @@
 
 #include "stdinc.h"
 #include <web-server/Access.h>
+#include <web-server/TokenBucket.h>
 
 #include <airdcpp/typedefs.h>
 #include <airdcpp/GetSet.h>
@@ -76,7 +77,15 @@ namespace webserver {
 		int countPermissions() const noexcept;
 
 		static bool validateUsername(const string& aUsername) noexcept;
+
+		// API request rate limiting shared by all sessions of the user
+		TokenBucket& getRequestBucket(bool aExpensive) noexcept {
+			return aExpensive ? expensiveRequests : requests;
+		}
 	private:
+		TokenBucket requests;
+		TokenBucket expensiveRequests;
+
 		void clearPermissions() noexcept;
 		int activeSessions = 0;
 
@@ -146,17 +146,17 @@ namespace webserver {
 			setDirty();
 		}
 
-		{
-			WLock l(cs);
-
-			// Single session per user when using basic auth
-			dcassert(aType != Session::TYPE_BASIC_AUTH || boost::find_if(sessionsRemoteId | map_values, [&](const SessionPtr& aSession) {
-				return aSession->getSessionType() == Session::TYPE_BASIC_AUTH && aSession->getUser() == aUser;
-			}).base() == sessionsRemoteId.end());
-
-			sessionsRemoteId.emplace(session->getAuthToken(), session);
-			sessionsLocalId.emplace(session->getId(), session);
+#ifdef _DEBUG
+		// Single session per user when using basic auth
+		if (aType == Session::TYPE_BASIC_AUTH) {
+			sessionsLocalId.forEach([&](const SessionPtr& aSession) {
+				dcassert(aSession->getSessionType() != Session::TYPE_BASIC_AUTH || aSession->getUser() != aUser);
+			});
 		}
+#endif
+
+		sessionsRemoteId.emplace(session->getAuthToken(), session);
+		sessionsLocalId.emplace(session->getId(), session);
 
 		fire(WebUserManagerListener::SessionCreated(), session);
 		return session;
@@ -172,41 +172,26 @@ namespace webserver {
 	}
 
 	SessionList WebUserManager::getSessions() const noexcept {
-		SessionList ret;
-
-		{
-			RLock l(cs);
-			boost::range::copy(sessionsLocalId | map_values, back_inserter(ret));
-		}
-
-		return ret;
+		return sessionsLocalId.values();
 	}
 
 	SessionPtr WebUserManager::getSession(const string& aSession) const noexcept {
-		RLock l(cs);
-		auto s = sessionsRemoteId.find(aSession);
-		if (s == sessionsRemoteId.end()) {
-			return nullptr;
-		}
-
-		return s->second;
+		return sessionsRemoteId.find(aSession);
 	}
 
 	SessionPtr WebUserManager::getSession(LocalSessionId aId) const noexcept {
-		RLock l(cs);
-		auto s = sessionsLocalId.find(aId);
-		if (s == sessionsLocalId.end()) {
-			return nullptr;
-		}
-
-		return s->second;
+		return sessionsLocalId.find(aId);
 	}
 
 	size_t WebUserManager::getUserSessionCount() const noexcept {
-		RLock l(cs);
-		return boost::count_if(sessionsLocalId | map_values, [=](const SessionPtr& s) {
-			return s->getSessionType() != Session::TYPE_EXTENSION;
+		size_t ret = 0;
+		sessionsLocalId.forEach([&ret](const SessionPtr& s) {
+			if (s->getSessionType() != Session::TYPE_EXTENSION) {
+				ret++;
+			}
 		});
+
+		return ret;
 	}
 
 	void WebUserManager::logout(const SessionPtr& aSession) {
@@ -234,12 +219,11 @@ namespace webserver {
 		SessionList removedSession;
 		auto tick = GET_TICK();
 
-		{
-			RLock l(cs);
-			boost::algorithm::copy_if(sessionsLocalId | map_values, back_inserter(removedSession), [=](const SessionPtr& s) {
-				return s->getMaxInactivity() > 0 && s->getLastActivity() + s->getMaxInactivity() < tick;
-			});
-		}
+		sessionsLocalId.forEach([&](const SessionPtr& s) {
+			if (s->getMaxInactivity() > 0 && s->getLastActivity() + s->getMaxInactivity() < tick) {
+				removedSession.push_back(s);
+			}
+		});
 
 		for (const auto& s : removedSession) {
 			// Don't remove sessions with active socket
@@ -272,11 +256,8 @@ namespace webserver {
 		aSession->getUser()->removeSession();
 		fire(WebUserManagerListener::UserUpdated(), aSession->getUser());
 
-		{
-			WLock l(cs);
-			sessionsRemoteId.erase(aSession->getAuthToken());
-			sessionsLocalId.erase(aSession->getId());
-		}
+		sessionsRemoteId.erase(aSession->getAuthToken());
+		sessionsLocalId.erase(aSession->getId());
 
 		fire(WebUserManagerListener::SessionRemoved(), aSession, aTimedOut);
 	}
@@ -299,15 +280,8 @@ namespace webserver {
 		expirationTimer = nullptr;
 
 		// Let the modules handle deletion in a clean way before we are shutting down...
-		SessionList sessions;
-
-		{
-			WLock l(cs);
-			boost::copy(sessionsLocalId | map_values, back_inserter(sessions));
-
-			sessionsLocalId.clear();
-			sessionsRemoteId.clear();
-		}
+		auto sessions = sessionsLocalId.clear();
+		sessionsRemoteId.clear();
 
 		while (true) {
 			if (all_of(sessions.begin(), sessions.end(), [](const SessionPtr& aSession) {
@@ -485,12 +459,11 @@ namespace webserver {
 	void WebUserManager::removeSessions(const WebUserPtr& aUser) noexcept {
 		SessionList removedSession;
 
-		{
-			RLock l(cs);
-			boost::algorithm::copy_if(sessionsLocalId | map_values, back_inserter(removedSession), [=](const SessionPtr& s) {
-				return s->getUser() == aUser;
-			});
-		}
+		sessionsLocalId.forEach([&](const SessionPtr& s) {
+			if (s->getUser() == aUser) {
+				removedSession.push_back(s);
+			}
+		});
 
 		for (const auto& s: removedSession) {
 			auto socket = server->getSocket(s->getId());
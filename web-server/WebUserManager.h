@@ -26,6 +26,7 @@
 
 #include <web-server/FloodCounter.h>
 #include <web-server/Session.h>
+#include <web-server/ShardedMap.h>
 #include <web-server/Timer.h>
 #include <web-server/WebServerManagerListener.h>
 #include <web-server/WebUserManagerListener.h>
@@ -88,8 +89,9 @@ namespace webserver {
 
 		std::map<std::string, WebUserPtr> users;
 
-		std::map<std::string, SessionPtr> sessionsRemoteId;
-		std::map<LocalSessionId, SessionPtr> sessionsLocalId;
+		// Session lookups are performed for each HTTP request and socket event, keep them off the global lock
+		ShardedMap<std::string, SessionPtr> sessionsRemoteId;
+		ShardedMap<LocalSessionId, SessionPtr> sessionsLocalId;
 		std::map<string, TokenInfo> refreshTokens;
 
 		void checkExpiredSessions() noexcept;